@@ -0,0 +1,152 @@
+#include "columns.hpp"
+#include "corpus.hpp"
+#include "lexer.hpp"
+#include "line_table.hpp"
+#include "source_buffer.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <fmt/format.h>
+#include <string>
+#include <string_view>
+#include <utf8proc.h>
+#include <utility>
+#include <vector>
+
+struct WidthInput final {
+    std::string_view name;
+    std::u8string_view line;
+};
+
+static constexpr auto width_inputs = std::array{
+    WidthInput{ "short ascii", u8"    let x: std::U32 = y;" },
+    WidthInput{ "long ascii",
+                u8"function process_all{T}(first: T, second: std::U32, third: std::Bool, fourth: std::Char) ~> T { }" },
+    WidthInput{ "tabbed", u8"\t\tlet counter: std::U32 = zählen;" },
+    WidthInput{ "mostly non-ascii", u8"function größe(Straße: 数字, 名前: Zeichen) ~> 数字 { }" },
+};
+
+static constexpr usize num_width_iterations = 1'000'000;
+static constexpr auto column_corpus_size = usize{ 1024 * 1024 };
+static constexpr usize num_runs = 11;
+
+// the previous implementation, it decodes every codepoint, ASCII or not
+[[nodiscard]] static usize width_of_every_codepoint(const std::u8string_view string) {
+    auto width = usize{ 0 };
+    auto current = reinterpret_cast<const utf8proc_uint8_t*>(string.data());
+    const auto end = current + string.length();
+    auto codepoint = utf8proc_int32_t{};
+    while (current < end) {
+        current += utf8proc_iterate(current, end - current, &codepoint);
+        width += static_cast<usize>(utf8proc_charwidth(codepoint));
+    }
+    return width;
+}
+
+// the median duration of a run, the function returns a checksum so that the work can't be optimized away
+template<typename Function>
+[[nodiscard]] static std::chrono::nanoseconds median_duration(Function function, usize& checksum) {
+    auto durations = std::vector<std::chrono::nanoseconds>{};
+    for (usize run = 0; run < num_runs; ++run) {
+        const auto start = std::chrono::steady_clock::now();
+        checksum += function();
+        durations.push_back(std::chrono::steady_clock::now() - start);
+    }
+    std::ranges::sort(durations);
+    return durations[durations.size() / 2];
+}
+
+[[nodiscard]] static double nanoseconds_per(const std::chrono::nanoseconds duration, const usize count) {
+    return static_cast<double>(duration.count()) / static_cast<double>(count);
+}
+
+static void measure_widths() {
+    fmt::print(
+            "{:<20}{:>8}{:>8}{:>16}{:>16}{:>10}{:>10}\n", "utf8_width", "bytes", "width", "every codepoint",
+            "ascii blocks", "speedup", "matches"
+    );
+    for (const auto& [name, line] : width_inputs) {
+        auto reference_checksum = usize{ 0 };
+        const auto reference = median_duration(
+                [&]() {
+                    auto sum = usize{ 0 };
+                    for (usize i = 0; i < num_width_iterations; ++i) {
+                        sum += width_of_every_codepoint(line.substr(i % 4));
+                    }
+                    return sum;
+                },
+                reference_checksum
+        );
+        auto checksum = usize{ 0 };
+        const auto blocks = median_duration(
+                [&]() {
+                    auto sum = usize{ 0 };
+                    for (usize i = 0; i < num_width_iterations; ++i) {
+                        sum += utils::utf8_width(line.substr(i % 4)).value();
+                    }
+                    return sum;
+                },
+                checksum
+        );
+        fmt::print(
+                "{:<20}{:>8}{:>8}{:>13.1f} ns{:>13.1f} ns{:>9.2f}x{:>10}\n", name, line.length(),
+                utils::utf8_width(line).value(), nanoseconds_per(reference, num_width_iterations),
+                nanoseconds_per(blocks, num_width_iterations),
+                static_cast<double>(reference.count()) / static_cast<double>(blocks.count()),
+                (checksum == reference_checksum ? "yes" : "NO")
+        );
+    }
+}
+
+static void measure_columns() {
+    fmt::print(
+            "\n{:<20}{:>8}{:>12}{:>16}{:>16}{:>10}{:>10}\n", "column numbers", "lines", "locations", "one by one",
+            "batched", "speedup", "matches"
+    );
+    for (const auto shape : corpus_shapes) {
+        auto source_code = SourceBuffer::from_string(generate_corpus(shape.shape, column_corpus_size));
+        const auto file_id = SourceFiles::add(fmt::format("{}-columns.bs", shape.name), std::move(source_code)).value();
+        const auto& line_table = SourceFiles::get(file_id).line_table();
+        const auto tokens = tokenize(file_id).value();
+        auto offsets = std::vector<usize>{};
+        offsets.reserve(tokens.size());
+        for (const auto& token : tokens) {
+            offsets.push_back(token.location().offset());
+        }
+
+        auto one_by_one_checksum = usize{ 0 };
+        const auto one_by_one = median_duration(
+                [&]() {
+                    auto sum = usize{ 0 };
+                    for (const auto offset : offsets) {
+                        sum += line_table.column_number(offset);
+                    }
+                    return sum;
+                },
+                one_by_one_checksum
+        );
+        auto batched_checksum = usize{ 0 };
+        const auto batched = median_duration(
+                [&]() {
+                    auto sum = usize{ 0 };
+                    for (const auto column : line_table.column_numbers(offsets)) {
+                        sum += column;
+                    }
+                    return sum;
+                },
+                batched_checksum
+        );
+        fmt::print(
+                "{:<20}{:>8}{:>12}{:>13.1f} ns{:>13.1f} ns{:>9.2f}x{:>10}\n", shape.name, line_table.num_lines(),
+                offsets.size(), nanoseconds_per(one_by_one, offsets.size()), nanoseconds_per(batched, offsets.size()),
+                static_cast<double>(one_by_one.count()) / static_cast<double>(batched.count()),
+                (batched_checksum == one_by_one_checksum ? "yes" : "NO")
+        );
+    }
+}
+
+void run_columns_benchmark() {
+    measure_widths();
+    measure_columns();
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+// Microbenchmarks for the display width and column computations that diagnostics and token dumps rely on.
+// utils::utf8_width is compared to decoding every codepoint, and LineTable::column_numbers to looking up every
+// location on its own. Every measurement also checks that both ways agree.
+void run_columns_benchmark();
@@ -0,0 +1,227 @@
+#include "corpus.hpp"
+#include <fmt/format.h>
+#include <span>
+
+using namespace std::string_view_literals;
+
+// none of these are keywords, and identifiers always get a numeric suffix, so they can never become one
+static constexpr auto ascii_words = std::array{
+    u8"value"sv,  u8"index"sv,  u8"token"sv,  u8"stream"sv, u8"buffer"sv, u8"parse"sv,  u8"compute"sv, u8"element"sv,
+    u8"key"sv,    u8"vector"sv, u8"map"sv,    u8"result"sv, u8"count"sv,  u8"offset"sv, u8"length"sv,  u8"node"sv,
+    u8"scope"sv,  u8"symbol"sv, u8"source"sv, u8"target"sv, u8"first"sv,  u8"second"sv, u8"left"sv,    u8"right"sv,
+};
+
+static constexpr auto non_ascii_words = std::array{
+    u8"größe"sv, u8"länge"sv, u8"naïve"sv, u8"café"sv, u8"μέγεθος"sv, u8"όνομα"sv,
+    u8"имя"sv,   u8"значение"sv, u8"変数"sv,  u8"関数"sv, u8"数据"sv,   u8"列表"sv,
+};
+
+static constexpr auto comment_words = std::array{
+    u8"the"sv,   u8"parser"sv, u8"keeps"sv, u8"track"sv, u8"of"sv,    u8"every"sv,  u8"token"sv,  u8"and"sv,
+    u8"node"sv,  u8"so"sv,     u8"that"sv,  u8"errors"sv, u8"can"sv,  u8"be"sv,     u8"reported"sv, u8"with"sv,
+    u8"their"sv, u8"source"sv, u8"location"sv, u8"later"sv, u8"on"sv, u8"todo:"sv, u8"note:"sv, u8"see"sv,
+};
+
+// SplitMix64, unlike the standard distributions it results in the same sequence on every platform
+struct Random final {
+private:
+    u64 m_state;
+
+public:
+    explicit Random(const u64 seed) : m_state{ seed } { }
+
+    [[nodiscard]] u64 next() {
+        m_state += 0x9E37'79B9'7F4A'7C15;
+        auto result = m_state;
+        result = (result ^ (result >> 30)) * 0xBF58'476D'1CE4'E5B9;
+        result = (result ^ (result >> 27)) * 0x94D0'49BB'1331'11EB;
+        return result ^ (result >> 31);
+    }
+
+    // in [min, max]
+    [[nodiscard]] usize between(const usize min, const usize max) {
+        return min + static_cast<usize>(next() % (max - min + 1));
+    }
+
+    [[nodiscard]] std::u8string_view choose(const std::span<const std::u8string_view> words) {
+        return words[between(0, words.size() - 1)];
+    }
+};
+
+struct CorpusGenerator final {
+private:
+    CorpusShape m_shape;
+    usize m_size;
+    Random m_random;
+    std::span<const std::u8string_view> m_words;
+    std::u8string m_result;
+    usize m_num_definitions{ 0 };
+
+public:
+    CorpusGenerator(const CorpusShape shape, const usize size)
+        : m_shape{ shape },
+          m_size{ size },
+          m_random{ static_cast<u64>(shape) + 1 },
+          m_words{ shape == CorpusShape::NonAscii ? std::span<const std::u8string_view>{ non_ascii_words }
+                                                  : std::span<const std::u8string_view>{ ascii_words } } {
+        m_result.reserve(size + 4 * 1024);
+    }
+
+    [[nodiscard]] std::u8string generate() {
+        if (m_shape == CorpusShape::ManyImports) {
+            while (m_result.length() < m_size) {
+                import();
+            }
+            // at least a single definition after all the imports
+            function_definition(0, 0);
+            return std::move(m_result);
+        }
+
+        while (m_result.length() < m_size) {
+            switch (m_shape) {
+                case CorpusShape::CommentHeavy:
+                    comments();
+                    function_definition(0, 0);
+                    break;
+                case CorpusShape::IdentifierHeavy:
+                    function_definition(0, 0);
+                    break;
+                case CorpusShape::DeepNesting:
+                    function_definition(0, m_random.between(8, 48));
+                    break;
+                case CorpusShape::NonAscii:
+                    if (m_random.between(0, 3) == 0) {
+                        comments();
+                    }
+                    function_definition(0, m_random.between(0, 2));
+                    break;
+                case CorpusShape::ManyImports:
+                    break;
+            }
+        }
+        return std::move(m_result);
+    }
+
+private:
+    void append(const std::u8string_view text) {
+        m_result += text;
+    }
+
+    void append_number(const usize number) {
+        const auto digits = fmt::format("{}", number);
+        m_result.append(digits.begin(), digits.end());
+    }
+
+    void indentation(const usize depth) {
+        m_result.append(4 * depth, u8' ');
+    }
+
+    // e.g. `token_stream_12`
+    void identifier(const usize max_num_words) {
+        const auto num_words = m_random.between(1, max_num_words);
+        for (usize i = 0; i < num_words; ++i) {
+            append(m_random.choose(m_words));
+            append(u8"_");
+        }
+        append_number(m_random.between(0, 99));
+    }
+
+    // e.g. `std::vector_3`
+    void name() {
+        const auto num_segments = m_random.between(1, 3);
+        for (usize i = 0; i < num_segments; ++i) {
+            if (i > 0) {
+                append(u8"::");
+            }
+            identifier(2);
+        }
+    }
+
+    void import() {
+        append(u8"import ");
+        name();
+        append(u8";\n");
+    }
+
+    void comment_text(const usize num_words) {
+        for (usize i = 0; i < num_words; ++i) {
+            append(u8" ");
+            if (m_shape == CorpusShape::NonAscii and m_random.between(0, 1) == 0) {
+                append(m_random.choose(non_ascii_words));
+            } else {
+                append(m_random.choose(comment_words));
+            }
+        }
+    }
+
+    void comments() {
+        const auto num_lines = m_random.between(2, 6);
+        for (usize i = 0; i < num_lines; ++i) {
+            append(u8"//");
+            comment_text(m_random.between(4, 14));
+            append(u8"\n");
+        }
+        if (m_random.between(0, 1) == 0) {
+            append(u8"/*");
+            comment_text(m_random.between(8, 40));
+            append(u8"\n   /*");
+            comment_text(m_random.between(2, 8));
+            append(u8" */\n  ");
+            comment_text(m_random.between(4, 20));
+            append(u8"\n*/\n");
+        }
+    }
+
+    void function_definition(const usize depth, const usize max_depth) {
+        indentation(depth);
+        if (depth == 0 and m_random.between(0, 3) == 0) {
+            append(u8"export ");
+        }
+        append(u8"function ");
+        identifier(3);
+        append(u8"_");
+        append_number(m_num_definitions++);
+
+        if (m_random.between(0, 2) == 0) {
+            append(u8"{");
+            const auto num_type_parameters = m_random.between(1, 3);
+            for (usize i = 0; i < num_type_parameters; ++i) {
+                if (i > 0) {
+                    append(u8", ");
+                }
+                identifier(1);
+            }
+            append(u8"}");
+        }
+
+        append(u8"(");
+        const auto num_parameters = m_random.between(0, 4);
+        for (usize i = 0; i < num_parameters; ++i) {
+            if (i > 0) {
+                append(u8", ");
+            }
+            identifier(2);
+            append(u8": ");
+            name();
+        }
+        append(u8")");
+
+        if (m_random.between(0, 1) == 0) {
+            append(u8" ~> ");
+            name();
+        }
+
+        if (depth == max_depth) {
+            append(u8" { }\n");
+            return;
+        }
+        append(u8" {\n");
+        function_definition(depth + 1, max_depth);
+        indentation(depth);
+        append(u8"}\n");
+    }
+};
+
+[[nodiscard]] std::u8string generate_corpus(const CorpusShape shape, const usize size) {
+    return CorpusGenerator{ shape, size }.generate();
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "types.hpp"
+#include <array>
+#include <string>
+#include <string_view>
+
+enum class CorpusShape {
+    CommentHeavy,
+    IdentifierHeavy,
+    DeepNesting,
+    ManyImports,
+    NonAscii,
+};
+
+struct CorpusShapeName final {
+    CorpusShape shape;
+    std::string_view name;
+};
+
+inline constexpr auto corpus_shapes = std::array{
+    CorpusShapeName{    CorpusShape::CommentHeavy,    "comment-heavy"},
+    CorpusShapeName{ CorpusShape::IdentifierHeavy, "identifier-heavy"},
+    CorpusShapeName{     CorpusShape::DeepNesting,     "deep-nesting"},
+    CorpusShapeName{     CorpusShape::ManyImports,     "many-imports"},
+    CorpusShapeName{        CorpusShape::NonAscii,        "non-ascii"},
+};
+
+// Generates a valid program of (at least) the given size in bytes. The same shape and size always result in
+// the same program, on every platform, so benchmark results stay comparable across runs.
+[[nodiscard]] std::u8string generate_corpus(CorpusShape shape, usize size);
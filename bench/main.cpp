@@ -0,0 +1,45 @@
+#include "columns.hpp"
+#include "recovery.hpp"
+#include "throughput.hpp"
+#include <charconv>
+#include <cstdlib>
+#include <fmt/format.h>
+#include <string_view>
+
+// usage: seatbelt2_bench [--max-size=<bytes>] [--recovery] [--columns]
+int main(const int argc, const char* const* const argv) {
+    static constexpr auto max_size_option = std::string_view{ "--max-size=" };
+    static constexpr auto recovery_option = std::string_view{ "--recovery" };
+    static constexpr auto columns_option = std::string_view{ "--columns" };
+
+    auto max_corpus_size = usize{ 100 * 1024 * 1024 };
+    auto recovery = false;
+    auto columns = false;
+    for (int i = 1; i < argc; ++i) {
+        const auto argument = std::string_view{ argv[i] };
+        if (argument.starts_with(max_size_option)) {
+            const auto value = argument.substr(max_size_option.length());
+            const auto result = std::from_chars(value.data(), value.data() + value.length(), max_corpus_size);
+            if (result.ec != std::errc{} or result.ptr != value.data() + value.length()) {
+                fmt::print(stderr, "invalid corpus size: {}\n", value);
+                return EXIT_FAILURE;
+            }
+        } else if (argument == recovery_option) {
+            recovery = true;
+        } else if (argument == columns_option) {
+            columns = true;
+        } else {
+            fmt::print(stderr, "unknown argument: {}\n", argument);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (recovery) {
+        run_recovery_benchmark();
+    } else if (columns) {
+        run_columns_benchmark();
+    } else {
+        run_throughput_benchmark(max_corpus_size);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,80 @@
+#include "recovery.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "source_buffer.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <fmt/format.h>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+struct BenchmarkInput final {
+    std::string_view name;
+    std::u8string_view snippet;
+};
+
+static constexpr auto inputs = std::array{
+    BenchmarkInput{  "valid functions", u8"function f{T}(a: T, b: std::U32) ~> T { }\n"},
+    BenchmarkInput{   "broken imports",                             u8"import std::;\n"},
+    BenchmarkInput{     "stray tokens",                                    u8"let x;\n"},
+    BenchmarkInput{ "broken functions",                       u8"function f(x: ) { }\n"},
+};
+
+static constexpr auto num_repetitions = std::array<usize, 3>{ 1'000, 10'000, 100'000 };
+static constexpr usize num_runs = 11;
+
+template<typename Parse>
+[[nodiscard]] static std::chrono::nanoseconds median_parse_time(const TokenVector& tokens, Parse parse) {
+    auto durations = std::vector<std::chrono::nanoseconds>{};
+    for (usize run = 0; run < num_runs; ++run) {
+        const auto start = std::chrono::steady_clock::now();
+        std::ignore = parse(tokens);
+        durations.push_back(std::chrono::steady_clock::now() - start);
+    }
+    std::ranges::sort(durations);
+    return durations[durations.size() / 2];
+}
+
+[[nodiscard]] static std::u8string repeat(const std::u8string_view snippet, const usize count) {
+    auto result = std::u8string{};
+    result.reserve(snippet.length() * count);
+    for (usize i = 0; i < count; ++i) {
+        result += snippet;
+    }
+    return result;
+}
+
+void run_recovery_benchmark() {
+    auto pool = ThreadPool{};
+    fmt::print(
+            "{:<20}{:>12}{:>12}{:>12}{:>16}{:>16}{:>16}\n", "input", "repetitions", "tokens", "errors", "parse time",
+            "per repetition", fmt::format("{} threads", pool.num_threads())
+    );
+    for (const auto& [name, snippet] : inputs) {
+        for (const auto repetitions : num_repetitions) {
+            const auto file_id =
+                    SourceFiles::add(std::string{ name }, SourceBuffer::from_string(repeat(snippet, repetitions)))
+                            .value();
+            const auto tokens = tokenize(file_id).value();
+
+            const auto result = parse(tokens);
+            const auto num_errors = (result.has_value() ? 0 : result.error().size());
+
+            const auto median = static_cast<double>(
+                    median_parse_time(tokens, [](const TokenVector& input) { return parse(input); }).count()
+            );
+            const auto parallel_median = static_cast<double>(
+                    median_parse_time(tokens, [&](const TokenVector& input) { return parse(input, pool); }).count()
+            );
+
+            fmt::print(
+                    "{:<20}{:>12}{:>12}{:>12}{:>13.3f} ms{:>13.1f} ns{:>13.3f} ms\n", name, repetitions, tokens.size(),
+                    num_errors, median / 1e6, median / static_cast<double>(repetitions), parallel_median / 1e6
+            );
+        }
+    }
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+// Measures how parsing time scales with the number of errors in the input. Every input repeats the
+// same snippet, so the time per error should stay the same no matter how many errors there are. Every
+// input is parsed on a single thread as well as on a thread pool.
+void run_recovery_benchmark();
@@ -0,0 +1,87 @@
+#include "throughput.hpp"
+#include "corpus.hpp"
+#include "lexer.hpp"
+#include "memory_usage.hpp"
+#include "parser.hpp"
+#include "source_buffer.hpp"
+#include "statistics.hpp"
+#include "version.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <fmt/format.h>
+#include <string>
+#include <tuple>
+#include <vector>
+
+static constexpr auto corpus_sizes = std::array<usize, 5>{
+    1024, 64 * 1024, 1024 * 1024, 16 * 1024 * 1024, 100 * 1024 * 1024,
+};
+
+// smaller corpora are measured more often, so that every measurement takes roughly the same time
+static constexpr usize bytes_per_measurement = 256 * 1024 * 1024;
+static constexpr usize min_num_runs = 3;
+static constexpr usize max_num_runs = 101;
+
+[[nodiscard]] static std::string to_json(const Optional<usize> value) {
+    return value ? fmt::format("{}", *value) : std::string{ "null" };
+}
+
+template<typename Function>
+[[nodiscard]] static double median_seconds(const usize num_runs, Function function) {
+    auto durations = std::vector<std::chrono::duration<double>>{};
+    for (usize run = 0; run < num_runs; ++run) {
+        const auto start = std::chrono::steady_clock::now();
+        function();
+        durations.emplace_back(std::chrono::steady_clock::now() - start);
+    }
+    std::ranges::sort(durations);
+    return durations[durations.size() / 2].count();
+}
+
+[[nodiscard]] static std::string measure(const CorpusShapeName shape, const usize size) {
+    auto source_code = SourceBuffer::from_string(generate_corpus(shape.shape, size));
+    const auto file_id = SourceFiles::add(fmt::format("{}-{}.bs", shape.name, size), std::move(source_code)).value();
+    // so that the peak does not include the peaks of previous (larger) corpora
+    reset_peak_rss();
+    const auto baseline_rss = current_rss();
+
+    const auto num_bytes = SourceFiles::get(file_id).source_code().length();
+    const auto num_runs = std::clamp(bytes_per_measurement / num_bytes, min_num_runs, max_num_runs);
+
+    const auto tokens = tokenize(file_id).value();
+    const auto tokenize_seconds = median_seconds(num_runs, [&]() { std::ignore = tokenize(file_id); });
+
+    const auto program = parse(tokens);
+    const auto num_errors = (program.has_value() ? 0 : program.error().size());
+    const auto num_nodes = (program.has_value() ? count_nodes(*program) : 0);
+    const auto parse_seconds = median_seconds(num_runs, [&]() { std::ignore = parse(tokens); });
+
+    const auto megabytes = static_cast<double>(num_bytes) / 1e6;
+    return fmt::format(
+            R"({{"shape": "{}", "size": {}, "bytes": {}, "tokens": {}, "nodes": {}, "parse_errors": {}, )"
+            R"("runs": {}, "tokenize": {{"median_ms": {:.3f}, "mb_per_s": {:.2f}, "tokens_per_s": {:.0f}}}, )"
+            R"("parse": {{"median_ms": {:.3f}, "nodes_per_s": {:.0f}}}, )"
+            R"("baseline_rss_bytes": {}, "peak_rss_bytes": {}}})",
+            shape.name, size, num_bytes, tokens.size(), num_nodes, num_errors, num_runs, tokenize_seconds * 1e3,
+            megabytes / tokenize_seconds, static_cast<double>(tokens.size()) / tokenize_seconds, parse_seconds * 1e3,
+            static_cast<double>(num_nodes) / parse_seconds, to_json(baseline_rss), to_json(peak_rss())
+    );
+}
+
+void run_throughput_benchmark(const usize max_corpus_size) {
+    fmt::print("{{\n  \"version\": \"{}\",\n  \"results\": [", compiler_version);
+    auto separator = "";
+    for (const auto shape : corpus_shapes) {
+        for (const auto size : corpus_sizes) {
+            if (size > max_corpus_size) {
+                continue;
+            }
+            fmt::print("{}\n    {}", separator, measure(shape, size));
+            std::fflush(stdout);
+            separator = ",";
+        }
+    }
+    fmt::print("\n  ]\n}}\n");
+}
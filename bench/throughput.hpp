@@ -0,0 +1,8 @@
+#pragma once
+
+#include "types.hpp"
+
+// Measures the throughput of the lexer (MB/s and tokens/s) and the parser (nodes/s) as well as the peak memory
+// usage on generated corpora of every shape and of growing sizes up to the given one. The results are printed
+// as JSON, always with the same structure and order, so they can be compared across runs.
+void run_throughput_benchmark(usize max_corpus_size);
@@ -0,0 +1,42 @@
+#include "arena.hpp"
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+Arena::~Arena() {
+    for (auto finalizer = m_finalizers; finalizer != nullptr; finalizer = finalizer->next) {
+        finalizer->destroy(finalizer->object);
+    }
+}
+
+[[nodiscard]] void* Arena::allocate_in_new_chunk(const usize size, const usize alignment) {
+    // oversized allocations get a chunk of their own, the allocation always fits into the new chunk
+    const auto new_chunk_size = std::max(m_next_chunk_size, size + alignment);
+    m_next_chunk_size = std::min(m_next_chunk_size * 2, chunk_size);
+    m_chunks.push_back(std::make_unique_for_overwrite<std::byte[]>(new_chunk_size));
+    m_num_allocated_bytes += new_chunk_size;
+    m_current = m_chunks.back().get();
+    m_remaining = new_chunk_size;
+    return allocate(size, alignment);
+}
+
+void Arena::absorb(Arena&& other) {
+    m_chunks.insert(
+            m_chunks.end(), std::make_move_iterator(other.m_chunks.begin()),
+            std::make_move_iterator(other.m_chunks.end())
+    );
+    other.m_chunks.clear();
+    other.m_current = nullptr;
+    other.m_remaining = 0;
+    m_num_allocated_bytes += std::exchange(other.m_num_allocated_bytes, 0);
+
+    // the objects of the other arena are destroyed first
+    if (other.m_finalizers != nullptr) {
+        auto last = other.m_finalizers;
+        while (last->next != nullptr) {
+            last = last->next;
+        }
+        last->next = m_finalizers;
+        m_finalizers = std::exchange(other.m_finalizers, nullptr);
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "types.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Bump allocator that releases all of its memory at once when it is destroyed. Objects that are
+// not trivially destructible are destroyed in reverse order of their creation.
+struct Arena final {
+private:
+    struct Finalizer final {
+        void (*destroy)(void* object);
+        void* object;
+        Finalizer* next;
+    };
+
+    static constexpr usize chunk_size = 64 * 1024;
+
+    // chunks start out at the given size and double until they reach chunk_size
+    usize m_next_chunk_size{ chunk_size };
+    std::vector<std::unique_ptr<std::byte[]>> m_chunks;
+    std::byte* m_current{ nullptr };
+    usize m_remaining{ 0 };
+    usize m_num_allocated_bytes{ 0 };
+    Finalizer* m_finalizers{ nullptr };
+
+    [[nodiscard]] void* allocate_in_new_chunk(usize size, usize alignment);
+
+public:
+    Arena() = default;
+    // for arenas that mostly stay small, like the ones holding the few nodes of an edited definition
+    explicit Arena(const usize first_chunk_size) : m_next_chunk_size{ std::min(first_chunk_size, chunk_size) } { }
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    ~Arena();
+
+    // takes over all memory and objects of the other arena (e.g. one that was filled on another thread)
+    void absorb(Arena&& other);
+
+    // memory that the arena took from the heap, not only what has been handed out from it
+    [[nodiscard]] usize num_allocated_bytes() const {
+        return m_num_allocated_bytes;
+    }
+
+    [[nodiscard]] void* allocate(const usize size, const usize alignment) {
+        auto pointer = static_cast<void*>(m_current);
+        auto space = m_remaining;
+        if (std::align(alignment, size, pointer, space) == nullptr) {
+            return allocate_in_new_chunk(size, alignment);
+        }
+        m_current = static_cast<std::byte*>(pointer) + size;
+        m_remaining = space - size;
+        return pointer;
+    }
+
+    template<typename T, typename... Args>
+    [[nodiscard]] T* create(Args&&... args) {
+        auto object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        if constexpr (not std::is_trivially_destructible_v<T>) {
+            const auto destroy = [](void* pointer) { static_cast<T*>(pointer)->~T(); };
+            const auto finalizer = allocate(sizeof(Finalizer), alignof(Finalizer));
+            m_finalizers = new (finalizer) Finalizer{ destroy, object, m_finalizers };
+        }
+        return object;
+    }
+
+    // arrays are never finalized, so only trivially destructible elements are allowed
+    template<typename T>
+    [[nodiscard]] std::span<const T> copy(const std::span<const T> elements) {
+        static_assert(std::is_trivially_destructible_v<T>);
+        if (elements.empty()) {
+            return {};
+        }
+        const auto destination = static_cast<T*>(allocate(elements.size_bytes(), alignof(T)));
+        std::uninitialized_copy(elements.begin(), elements.end(), destination);
+        return std::span<const T>{ destination, elements.size() };
+    }
+};
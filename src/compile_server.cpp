@@ -0,0 +1,278 @@
+#include "compile_server.hpp"
+#include "resident_modules.hpp"
+#include "thread_pool.hpp"
+#include <array>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <fmt/format.h>
+#include <system_error>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) or defined(__APPLE__)
+#include <cerrno>
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Messages can't be longer than this in total, so a broken message can't make the server allocate all of its memory.
+// Requests only consist of paths and arguments, but the responses (e.g. dumps of large files) can be a lot longer.
+static constexpr auto max_request_length = usize{ 64 } * 1024 * 1024;
+static constexpr auto max_response_length = usize{ 1 } << 30;
+static constexpr auto max_num_strings = usize{ 64 } * 1024;
+// clients are served one after another, so one that stops sending (or receiving) must not block the others
+static constexpr auto client_timeout_seconds = 10;
+
+// owns the file descriptor of a socket
+struct Socket final {
+private:
+    int m_fd;
+
+public:
+    explicit Socket(const int fd) : m_fd{ fd } { }
+
+    Socket(const Socket&) = delete;
+    Socket(Socket&& other) noexcept : m_fd{ std::exchange(other.m_fd, -1) } { }
+    Socket& operator=(const Socket&) = delete;
+    Socket& operator=(Socket&&) = delete;
+
+    ~Socket() {
+        if (m_fd >= 0) {
+            ::close(m_fd);
+        }
+    }
+
+    [[nodiscard]] int fd() const {
+        return m_fd;
+    }
+
+    [[nodiscard]] bool is_valid() const {
+        return m_fd >= 0;
+    }
+};
+
+// reads and writes fail once they have been waiting for longer than the timeout
+[[nodiscard]] static bool set_timeouts(const int fd) {
+    const auto timeout = timeval{ .tv_sec = client_timeout_seconds, .tv_usec = 0 };
+    return ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) == 0
+           and ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)) == 0;
+}
+
+[[nodiscard]] static bool write_all(const int fd, const std::span<const std::byte> bytes) {
+    auto written = usize{ 0 };
+    while (written < bytes.size()) {
+        const auto result = ::write(fd, bytes.data() + written, bytes.size() - written);
+        if (result < 0 and errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            return false;
+        }
+        written += static_cast<usize>(result);
+    }
+    return true;
+}
+
+[[nodiscard]] static bool read_all(const int fd, const std::span<std::byte> bytes) {
+    auto num_read = usize{ 0 };
+    while (num_read < bytes.size()) {
+        const auto result = ::read(fd, bytes.data() + num_read, bytes.size() - num_read);
+        if (result < 0 and errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            return false;
+        }
+        num_read += static_cast<usize>(result);
+    }
+    return true;
+}
+
+// the number of strings, followed by every string as its length and its characters (client and server always run
+// on the same machine, so there is no need for a fixed byte order)
+[[nodiscard]] static bool
+write_message(const int fd, const std::span<const std::string> strings, const usize max_length) {
+    if (strings.size() > max_num_strings) {
+        return false;
+    }
+    auto bytes = std::vector<std::byte>{};
+    const auto append_length = [&](const usize length) {
+        const auto value = static_cast<u32>(length);
+        const auto value_bytes = std::as_bytes(std::span{ &value, 1 });
+        bytes.insert(bytes.end(), value_bytes.begin(), value_bytes.end());
+    };
+    append_length(strings.size());
+    auto remaining_length = max_length;
+    for (const auto& string : strings) {
+        if (string.length() > remaining_length) {
+            return false;
+        }
+        remaining_length -= string.length();
+        append_length(string.length());
+        const auto string_bytes = std::as_bytes(std::span{ string });
+        bytes.insert(bytes.end(), string_bytes.begin(), string_bytes.end());
+    }
+    return write_all(fd, bytes);
+}
+
+[[nodiscard]] static Optional<std::vector<std::string>> read_message(const int fd, const usize max_length) {
+    const auto read_length = [&](const usize max_value) -> Optional<usize> {
+        auto value = u32{ 0 };
+        if (not read_all(fd, std::as_writable_bytes(std::span{ &value, 1 })) or value > max_value) {
+            return {};
+        }
+        return usize{ value };
+    };
+
+    const auto num_strings = read_length(max_num_strings);
+    if (not num_strings) {
+        return {};
+    }
+    auto remaining_length = max_length;
+    auto result = std::vector<std::string>{};
+    for (usize i = 0; i < *num_strings; ++i) {
+        const auto length = read_length(remaining_length);
+        if (not length) {
+            return {};
+        }
+        remaining_length -= *length;
+        auto& string = result.emplace_back(*length, '\0');
+        if (not read_all(fd, std::as_writable_bytes(std::span{ string }))) {
+            return {};
+        }
+    }
+    return result;
+}
+
+[[nodiscard]] static Optional<sockaddr_un> socket_address(const std::filesystem::path& socket_path) {
+    auto address = sockaddr_un{};
+    address.sun_family = AF_UNIX;
+    const auto path = socket_path.string();
+    // the path has to be null-terminated
+    if (path.length() >= sizeof(address.sun_path)) {
+        return {};
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.length() + 1);
+    return address;
+}
+
+[[nodiscard]] static Socket connect_to(const sockaddr_un& address) {
+    auto socket = Socket{ ::socket(AF_UNIX, SOCK_STREAM, 0) };
+    if (not socket.is_valid()
+        or ::connect(socket.fd(), reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        return Socket{ -1 };
+    }
+    return socket;
+}
+
+// the request consists of the working directory of the client, followed by its arguments
+[[nodiscard]] static DriverResult
+handle_request(const std::span<const std::string> request, ThreadPool& pool, ResidentModules& resident_modules) {
+    if (request.empty()) {
+        return DriverResult{ {}, "invalid request\n", EXIT_FAILURE };
+    }
+    auto options = parse_command_line(request.subspan(1));
+    if (not options) {
+        return std::move(options.error());
+    }
+    if (options->server_socket or options->language_server) {
+        return DriverResult{ {}, "the compile server cannot start another server\n", EXIT_FAILURE };
+    }
+    options->make_paths_absolute(request.front());
+    return run_driver(*options, pool, &resident_modules);
+}
+
+[[nodiscard]] ServerError run_server(const std::filesystem::path& socket_path, const usize num_jobs) {
+    const auto address = socket_address(socket_path);
+    if (not address) {
+        return ServerError::SocketPathTooLong;
+    }
+    // an existing socket is only replaced if there is no server listening on it anymore
+    if (connect_to(*address).is_valid()) {
+        return ServerError::ServerAlreadyRunning;
+    }
+    ::unlink(address->sun_path);
+
+    const auto listener = Socket{ ::socket(AF_UNIX, SOCK_STREAM, 0) };
+    if (not listener.is_valid()) {
+        return ServerError::CouldNotCreateSocket;
+    }
+    // only the user that started the server may connect to it, the socket file is created with these permissions
+    const auto previous_umask = ::umask(S_IXUSR | S_IRWXG | S_IRWXO);
+    const auto bound = (::bind(listener.fd(), reinterpret_cast<const sockaddr*>(&*address), sizeof(*address)) == 0);
+    ::umask(previous_umask);
+    if (not bound or ::listen(listener.fd(), SOMAXCONN) != 0) {
+        return ServerError::CouldNotBindSocket;
+    }
+
+    // clients that disconnect early must not take down the server
+    std::signal(SIGPIPE, SIG_IGN);
+
+    auto pool = ThreadPool{ num_jobs };
+    auto resident_modules = ResidentModules{};
+    fmt::print(stderr, "compile server listening on {}\n", socket_path.string());
+    while (true) {
+        const auto client = Socket{ ::accept(listener.fd(), nullptr, nullptr) };
+        if (not client.is_valid() or not set_timeouts(client.fd())) {
+            continue;
+        }
+        // a client that times out is dropped
+        const auto request = read_message(client.fd(), max_request_length);
+        if (not request) {
+            continue;
+        }
+        const auto result = handle_request(*request, pool, resident_modules);
+        // nothing refers to the previous contents of changed files once the build is done
+        resident_modules.release_replaced_files();
+        const auto response = std::array{ fmt::format("{}", result.exit_code), result.output, result.diagnostics };
+        // the client is gone if this fails, nothing else to do about it
+        std::ignore = write_message(client.fd(), response, max_response_length);
+    }
+}
+
+[[nodiscard]] Result<DriverResult, ServerError>
+run_client(const std::filesystem::path& socket_path, const std::span<const std::string> arguments) {
+    const auto address = socket_address(socket_path);
+    if (not address) {
+        return Error<ServerError>{ ServerError::SocketPathTooLong };
+    }
+    const auto server = connect_to(*address);
+    if (not server.is_valid()) {
+        return Error<ServerError>{ ServerError::CouldNotConnectToServer };
+    }
+
+    auto error = std::error_code{};
+    auto request = std::vector<std::string>{ std::filesystem::current_path(error).string() };
+    request.insert(request.end(), arguments.begin(), arguments.end());
+    if (not write_message(server.fd(), request, max_request_length)) {
+        return Error<ServerError>{ ServerError::ConnectionLost };
+    }
+
+    // the exit code, the output and the diagnostics
+    auto response = read_message(server.fd(), max_response_length);
+    if (not response or response->size() != 3) {
+        return Error<ServerError>{ ServerError::ConnectionLost };
+    }
+    const auto& exit_code_string = (*response)[0];
+    auto exit_code = 0;
+    const auto [end, error_code] =
+            std::from_chars(exit_code_string.data(), exit_code_string.data() + exit_code_string.size(), exit_code);
+    if (error_code != std::errc{} or end != exit_code_string.data() + exit_code_string.size()) {
+        return Error<ServerError>{ ServerError::ConnectionLost };
+    }
+    return DriverResult{ std::move((*response)[1]), std::move((*response)[2]), exit_code };
+}
+#else
+[[nodiscard]] ServerError run_server(const std::filesystem::path&, usize) {
+    return ServerError::UnsupportedPlatform;
+}
+
+[[nodiscard]] Result<DriverResult, ServerError> run_client(const std::filesystem::path&, std::span<const std::string>) {
+    return Error<ServerError>{ ServerError::UnsupportedPlatform };
+}
+#endif
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "driver.hpp"
+#include "types.hpp"
+#include <filesystem>
+#include <span>
+#include <string>
+
+enum class ServerError {
+    UnsupportedPlatform,
+    SocketPathTooLong,
+    CouldNotCreateSocket,
+    ServerAlreadyRunning,
+    CouldNotBindSocket,
+    CouldNotConnectToServer,
+    ConnectionLost,
+};
+
+// Keeps running as compile server on a Unix domain socket, so every build after the first one only has to read and
+// hash its files: the syntax trees of unchanged files, all interned identifiers and the threads of the pool stay
+// in memory. The clients are served one at a time, each one with all threads. Only returns if the server cannot
+// be started.
+[[nodiscard]] ServerError run_server(const std::filesystem::path& socket_path, usize num_jobs);
+
+// Sends the arguments (without the program name) and the current directory to the server, which compiles as if it
+// had been started with them in that directory. The result is what the server would have printed.
+[[nodiscard]] Result<DriverResult, ServerError>
+run_client(const std::filesystem::path& socket_path, std::span<const std::string> arguments);
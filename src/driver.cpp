@@ -0,0 +1,334 @@
+#include "driver.hpp"
+#include "lexer.hpp"
+#include "module_cache.hpp"
+#include "module_graph.hpp"
+#include "source_buffer.hpp"
+#include "statistics.hpp"
+#include "thread_pool.hpp"
+#include "version.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cxxopts.hpp>
+#include <fmt/format.h>
+#include <fstream>
+#include <magic_enum.hpp>
+#include <span>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+// what a single input has produced, it's only printed after all inputs are done
+struct InputResult final {
+    std::string output;
+    std::string diagnostics;
+    bool failed{ false };
+};
+
+[[nodiscard]] static std::string format_diagnostic(const SourceLocation location, const ErrorCode error_code) {
+    return fmt::format(
+            "{}:{}:{}: {} (\"{}\")\n", location.filename(), location.line_number(), location.column_number(),
+            magic_enum::enum_name(error_code), location.ascii_lexeme()
+    );
+}
+
+[[nodiscard]] static std::string format_io_error(const std::filesystem::path& path, const utils::IoError io_error) {
+    return fmt::format("{}: {}\n", path.string(), magic_enum::enum_name(io_error));
+}
+
+[[nodiscard]] static std::string format_diagnostics(const Module& module) {
+    auto result = std::string{};
+    if (module.program.has_value()) {
+        // only unresolved imports are left
+    } else if (const auto io_error = std::get_if<utils::IoError>(&module.program.error())) {
+        result += format_io_error(module.path, *io_error);
+    } else if (const auto lexer_error = std::get_if<LexerError>(&module.program.error())) {
+        result += format_diagnostic(lexer_error->location, lexer_error->error_code);
+    } else {
+        result += "parser error:\n";
+        for (const auto& error : std::get<ParserErrors>(module.program.error())) {
+            result += format_diagnostic(error.location, error.error_code);
+        }
+    }
+    for (const auto& location : module.unresolved_imports) {
+        result += format_diagnostic(location, ErrorCode::UnresolvedImport);
+    }
+    return result;
+}
+
+[[nodiscard]] static std::string format_tokens(const std::span<const Token> tokens) {
+    if (tokens.empty()) {
+        return {};
+    }
+    // the tokens of a file are in order, so their columns can be computed line by line
+    auto offsets = std::vector<usize>{};
+    offsets.reserve(tokens.size());
+    for (const auto& token : tokens) {
+        offsets.push_back(token.location().offset());
+    }
+    const auto columns = tokens.front().location().source_file().line_table().column_numbers(offsets);
+
+    auto result = std::string{};
+    for (usize i = 0; i < tokens.size(); ++i) {
+        const auto location = tokens[i].location();
+        result += fmt::format(
+                "{}:{}:{}: {} \"{}\"\n", location.filename(), location.line_number(), columns[i],
+                magic_enum::enum_name(tokens[i].type()), location.ascii_lexeme()
+        );
+    }
+    return result;
+}
+
+// the tokens don't depend on any other module, so imports are not loaded
+[[nodiscard]] static InputResult dump_tokens(
+        const std::filesystem::path& path,
+        Statistics* const statistics,
+        ResidentModules* const resident_modules
+) {
+    auto read_file_timer = PhaseTimer{ statistics, Phase::ReadFile, path };
+    const auto file_id = (resident_modules != nullptr ? resident_modules->load_file(path) : SourceFiles::load(path));
+    if (not file_id) {
+        return InputResult{ {}, format_io_error(path, file_id.error()), true };
+    }
+    read_file_timer.stop([&]() { return PhaseCounts{ 0, SourceFiles::get(*file_id).source_code().length() }; });
+
+    auto tokenize_timer = PhaseTimer{ statistics, Phase::Tokenize, path };
+    const auto tokens = tokenize(*file_id);
+    if (not tokens) {
+        return InputResult{ {}, format_diagnostic(tokens.error().location, tokens.error().error_code), true };
+    }
+    tokenize_timer.stop([&]() { return PhaseCounts{ tokens->size(), tokens->capacity() * sizeof(Token) }; });
+    return InputResult{ format_tokens(*tokens), {}, false };
+}
+
+// the diagnostics of every module are attributed to the first input that (directly or indirectly) imports it
+[[nodiscard]] static std::vector<InputResult> compile(
+        const DriverOptions& options,
+        ThreadPool& pool,
+        const ModuleCache* const cache,
+        Statistics* const statistics,
+        ResidentModules* const resident_modules
+) {
+    // imports are searched next to the inputs first
+    auto search_paths = std::vector<std::filesystem::path>{};
+    for (const auto& input : options.inputs) {
+        auto directory = input.parent_path();
+        if (std::ranges::find(search_paths, directory) == search_paths.end()) {
+            search_paths.push_back(std::move(directory));
+        }
+    }
+    search_paths.insert(search_paths.end(), options.import_paths.begin(), options.import_paths.end());
+
+    const auto module_graph = build_module_graph(
+            options.inputs, search_paths, pool, cache, statistics, resident_modules
+    );
+
+    auto results = std::vector<InputResult>(options.inputs.size());
+    const auto ordered_modules = module_graph.ordered_modules();
+    for (usize i = 0; i < results.size(); ++i) {
+        auto& result = results[i];
+        for (const auto module_index : ordered_modules[i]) {
+            const auto& module = module_graph.modules[module_index];
+            result.diagnostics += format_diagnostics(module);
+            if (not module.program.has_value() or not module.unresolved_imports.empty()) {
+                result.failed = true;
+            }
+        }
+    }
+
+    if (options.mode == DriverMode::DumpAst) {
+        for (usize i = 0; i < results.size(); ++i) {
+            const auto& module = module_graph.modules[module_graph.main_modules[i]];
+            if (module.program.has_value()) {
+                results[i].output = module.program->to_string();
+            }
+        }
+    }
+    return results;
+}
+
+// failing to write the file fails the whole run
+static void write_file(const std::filesystem::path& path, const std::string_view contents, DriverResult& result) {
+    auto file = std::ofstream{ path, std::ios::binary };
+    file << contents;
+    if (not file) {
+        result.diagnostics += format_io_error(path, utils::IoError::CouldNotOpenFile);
+        result.exit_code = EXIT_FAILURE;
+    }
+}
+
+[[nodiscard]] static Optional<std::filesystem::path>
+optional_path(const cxxopts::ParseResult& result, const std::string& name) {
+    if (result.count(name) == 0) {
+        return {};
+    }
+    return std::filesystem::path{ result[name].as<std::string>() };
+}
+
+// e.g. the help, the driver does not run afterwards
+[[nodiscard]] static Error<DriverResult> exit_with_output(std::string output) {
+    return Error<DriverResult>{ DriverResult{ std::move(output), {}, EXIT_SUCCESS } };
+}
+
+[[nodiscard]] static Error<DriverResult> exit_with_error(std::string message) {
+    return Error<DriverResult>{ DriverResult{ {}, std::move(message), EXIT_FAILURE } };
+}
+
+[[nodiscard]] Result<DriverOptions, DriverResult> parse_command_line(const std::span<const std::string> arguments) {
+    auto options = cxxopts::Options{ "Seatbelt2", "Compiler for the Backseat programming language" };
+    options.positional_help("<input files...>");
+    // clang-format off
+    options.add_options()
+            ("check", "only report errors (the default)")
+            ("dump-tokens", "print the tokens of every input")
+            ("dump-ast", "print the syntax tree of every input")
+            ("o,output", "write the output to this file instead of stdout", cxxopts::value<std::string>())
+            ("I,import-path", "also search this directory for imported modules",
+             cxxopts::value<std::vector<std::string>>())
+            ("j,jobs", "number of threads (0 uses one per hardware thread)",
+             cxxopts::value<usize>()->default_value("0"))
+            ("cache", "reuse the tokens and syntax trees of unchanged modules from this directory",
+             cxxopts::value<std::string>())
+            ("time-report", "print the time spent in every phase")
+            ("stats", "print the number of tokens and nodes, allocated memory and peak memory usage")
+            ("trace", "write every phase of every module to this file as a Chrome trace", cxxopts::value<std::string>())
+            ("server", "keep running as compile server on this socket, keeping unchanged modules in memory",
+             cxxopts::value<std::string>())
+            ("connect", "let the compile server on this socket compile the inputs", cxxopts::value<std::string>())
+            ("lsp", "run as language server on stdin and stdout")
+            ("version", "print the version")
+            ("h,help", "print this help");
+    // only given as positional arguments, so not part of the help
+    options.add_options("positional")
+            ("inputs", "input files", cxxopts::value<std::vector<std::string>>());
+    // clang-format on
+    options.parse_positional({ "inputs" });
+
+    // cxxopts expects the arguments as they are passed to main()
+    auto argv = std::vector<const char*>{ "Seatbelt2" };
+    for (const auto& argument : arguments) {
+        argv.push_back(argument.c_str());
+    }
+
+    auto driver_options = DriverOptions{};
+    try {
+        const auto result = options.parse(static_cast<int>(argv.size()), argv.data());
+        if (result.count("help") > 0) {
+            return exit_with_output(options.help({ "" }));
+        }
+        if (result.count("version") > 0) {
+            return exit_with_output(fmt::format("Seatbelt2 {}\n", compiler_version));
+        }
+
+        if (result.count("check") + result.count("dump-tokens") + result.count("dump-ast") > 1) {
+            return exit_with_error("only one of --check, --dump-tokens and --dump-ast can be given\n");
+        }
+        if (result.count("dump-tokens") > 0) {
+            driver_options.mode = DriverMode::DumpTokens;
+        } else if (result.count("dump-ast") > 0) {
+            driver_options.mode = DriverMode::DumpAst;
+        }
+
+        driver_options.server_socket = optional_path(result, "server");
+        driver_options.client_socket = optional_path(result, "connect");
+        driver_options.language_server = (result.count("lsp") > 0);
+        if ((driver_options.server_socket ? 1 : 0) + (driver_options.client_socket ? 1 : 0)
+                    + (driver_options.language_server ? 1 : 0)
+            > 1) {
+            return exit_with_error("only one of --server, --connect and --lsp can be given\n");
+        }
+
+        // the servers get the inputs from their clients
+        const auto is_server = (driver_options.server_socket or driver_options.language_server);
+        if (result.count("inputs") == 0 and not is_server) {
+            return exit_with_error("no input files\n" + options.help({ "" }));
+        }
+        if (result.count("inputs") > 0 and driver_options.language_server) {
+            return exit_with_error("the language server does not take input files\n");
+        }
+        if (result.count("inputs") > 0) {
+            for (const auto& input : result["inputs"].as<std::vector<std::string>>()) {
+                driver_options.inputs.emplace_back(input);
+            }
+        }
+        if (result.count("import-path") > 0) {
+            for (const auto& import_path : result["import-path"].as<std::vector<std::string>>()) {
+                driver_options.import_paths.emplace_back(import_path);
+            }
+        }
+        driver_options.output_path = optional_path(result, "output");
+        driver_options.num_jobs = result["jobs"].as<usize>();
+        driver_options.cache_directory = optional_path(result, "cache");
+        driver_options.time_report = (result.count("time-report") > 0);
+        driver_options.stats = (result.count("stats") > 0);
+        driver_options.trace_path = optional_path(result, "trace");
+    } catch (const cxxopts::exceptions::exception& exception) {
+        return exit_with_error(fmt::format("{}\n", exception.what()));
+    }
+    return driver_options;
+}
+
+void DriverOptions::make_paths_absolute(const std::filesystem::path& working_directory) {
+    // an absolute path replaces the working directory
+    const auto make_absolute = [&](std::filesystem::path& path) { path = working_directory / path; };
+    std::ranges::for_each(inputs, make_absolute);
+    std::ranges::for_each(import_paths, make_absolute);
+    for (auto path : { &output_path, &cache_directory, &trace_path }) {
+        if (*path) {
+            make_absolute(**path);
+        }
+    }
+}
+
+[[nodiscard]] DriverResult
+run_driver(const DriverOptions& options, ThreadPool& pool, ResidentModules* const resident_modules) {
+    auto cache = Optional<ModuleCache>{};
+    if (options.cache_directory) {
+        cache.emplace(*options.cache_directory);
+    }
+
+    // without any of the options, the phases are not measured at all
+    auto statistics = Optional<Statistics>{};
+    if (options.time_report or options.stats or options.trace_path) {
+        statistics.emplace();
+    }
+
+    auto results = std::vector<InputResult>{};
+    if (options.mode == DriverMode::DumpTokens) {
+        results.resize(options.inputs.size());
+        pool.for_each_index(options.inputs.size(), [&](const usize i) {
+            results[i] = dump_tokens(options.inputs[i], statistics ? &*statistics : nullptr, resident_modules);
+        });
+    } else {
+        results = compile(
+                options, pool, cache ? &*cache : nullptr, statistics ? &*statistics : nullptr, resident_modules
+        );
+    }
+
+    auto result = DriverResult{ {}, {}, EXIT_SUCCESS };
+    auto output = std::string{};
+    for (const auto& input_result : results) {
+        result.diagnostics += input_result.diagnostics;
+        output += input_result.output;
+        if (input_result.failed) {
+            result.exit_code = EXIT_FAILURE;
+        }
+    }
+
+    if (options.output_path) {
+        write_file(*options.output_path, output, result);
+    } else {
+        result.output = std::move(output);
+    }
+
+    if (options.time_report) {
+        result.diagnostics += statistics->time_report();
+    }
+    if (options.stats) {
+        result.diagnostics += statistics->summary();
+    }
+    if (options.trace_path) {
+        write_file(*options.trace_path, statistics->chrome_trace(), result);
+    }
+    return result;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "resident_modules.hpp"
+#include "thread_pool.hpp"
+#include "types.hpp"
+#include <filesystem>
+#include <span>
+#include <string>
+#include <vector>
+
+enum class DriverMode {
+    Check,
+    DumpTokens,
+    DumpAst,
+};
+
+struct DriverOptions final {
+    std::vector<std::filesystem::path> inputs;
+    // searched for imported modules after the directories of the inputs
+    std::vector<std::filesystem::path> import_paths;
+    DriverMode mode{ DriverMode::Check };
+    // without an output path, the output is written to stdout
+    Optional<std::filesystem::path> output_path;
+    // a value of zero uses one thread per hardware thread
+    usize num_jobs{ 0 };
+    Optional<std::filesystem::path> cache_directory;
+    bool time_report{ false };
+    bool stats{ false };
+    Optional<std::filesystem::path> trace_path;
+    // instead of compiling, run as compile server on this socket or let the server on this socket compile
+    Optional<std::filesystem::path> server_socket;
+    Optional<std::filesystem::path> client_socket;
+    // instead of compiling, run as language server on stdin and stdout
+    bool language_server{ false };
+
+    // relative paths are relative to the given directory afterwards (e.g. the one of a client of the server)
+    void make_paths_absolute(const std::filesystem::path& working_directory);
+};
+
+// what is to be printed on stdout and stderr by the process that was started by the user
+struct DriverResult final {
+    std::string output;
+    std::string diagnostics;
+    int exit_code;
+};
+
+// the arguments don't include the program name, the result is an error for invalid arguments, --help and --version
+[[nodiscard]] Result<DriverOptions, DriverResult> parse_command_line(std::span<const std::string> arguments);
+
+// Compiles all inputs within a single process, on a single thread pool. The inputs share the modules they import,
+// so every module is only loaded once. The output and the diagnostics are buffered until all inputs are done and
+// are in the order of the inputs, so they are the same for every number of jobs. The output is only part of the
+// result if it is not written to an output file.
+[[nodiscard]] DriverResult
+run_driver(const DriverOptions& options, ThreadPool& pool, ResidentModules* resident_modules = nullptr);
@@ -5,7 +5,10 @@ enum class ErrorCode {
     InvalidInput,
     MissingNewlineAtEndOfSourceCode,
     UnterminatedComment,
+    TokenTooLong,
     // parser errors
     UnexpectedToken,
+    // module errors
+    UnresolvedImport,
     // type errors
 };
@@ -0,0 +1,66 @@
+#include "hash.hpp"
+#include <array>
+#include <bit>
+#include <cstring>
+
+static constexpr u64 prime1 = 0x9E37'79B1'85EB'CA87;
+static constexpr u64 prime2 = 0xC2B2'AE3D'27D4'EB4F;
+static constexpr u64 prime3 = 0x1656'67B1'9E37'79F9;
+static constexpr u64 prime4 = 0x85EB'CA77'C2B2'AE63;
+static constexpr u64 prime5 = 0x27D4'EB2F'1656'67C5;
+
+template<typename T>
+[[nodiscard]] static T read(const std::byte* const data) {
+    auto result = T{};
+    std::memcpy(&result, data, sizeof(T));
+    return result;
+}
+
+[[nodiscard]] static u64 round(const u64 accumulator, const u64 input) {
+    return std::rotl(accumulator + input * prime2, 31) * prime1;
+}
+
+[[nodiscard]] static u64 merge_round(const u64 accumulator, const u64 value) {
+    return (accumulator ^ round(0, value)) * prime1 + prime4;
+}
+
+[[nodiscard]] u64 hash_bytes(const std::span<const std::byte> bytes, const u64 seed) {
+    auto data = bytes.data();
+    const auto end = data + bytes.size();
+    auto hash = u64{ 0 };
+
+    if (bytes.size() >= 32) {
+        auto accumulators = std::array{ seed + prime1 + prime2, seed + prime2, seed, seed - prime1 };
+        for (; end - data >= 32; data += 32) {
+            for (usize i = 0; i < accumulators.size(); ++i) {
+                accumulators[i] = round(accumulators[i], read<u64>(data + 8 * i));
+            }
+        }
+        hash = std::rotl(accumulators[0], 1) + std::rotl(accumulators[1], 7) + std::rotl(accumulators[2], 12)
+               + std::rotl(accumulators[3], 18);
+        for (const auto accumulator : accumulators) {
+            hash = merge_round(hash, accumulator);
+        }
+    } else {
+        hash = seed + prime5;
+    }
+    hash += bytes.size();
+
+    for (; end - data >= 8; data += 8) {
+        hash = std::rotl(hash ^ round(0, read<u64>(data)), 27) * prime1 + prime4;
+    }
+    if (end - data >= 4) {
+        hash = std::rotl(hash ^ (read<u32>(data) * prime1), 23) * prime2 + prime3;
+        data += 4;
+    }
+    for (; data < end; ++data) {
+        hash = std::rotl(hash ^ (std::to_integer<u64>(*data) * prime5), 11) * prime1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+    hash *= prime3;
+    hash ^= hash >> 32;
+    return hash;
+}
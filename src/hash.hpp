@@ -0,0 +1,8 @@
+#pragma once
+
+#include "types.hpp"
+#include <cstddef>
+#include <span>
+
+// XXH64, fast enough to hash whole source files to recognize unchanged ones (not cryptographically secure)
+[[nodiscard]] u64 hash_bytes(std::span<const std::byte> bytes, u64 seed = 0);
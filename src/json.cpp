@@ -0,0 +1,409 @@
+#include "json.hpp"
+#include <charconv>
+#include <cmath>
+#include <fmt/format.h>
+#include <iterator>
+#include <tuple>
+
+JsonValue::JsonValue(JsonArray value) : m_value{ std::move(value) } { }
+
+JsonValue::JsonValue(JsonObject value) : m_value{ std::move(value) } { }
+
+[[nodiscard]] Optional<bool> JsonValue::as_bool() const {
+    if (const auto value = std::get_if<bool>(&m_value)) {
+        return *value;
+    }
+    return {};
+}
+
+[[nodiscard]] Optional<double> JsonValue::as_number() const {
+    if (const auto value = std::get_if<double>(&m_value)) {
+        return *value;
+    }
+    return {};
+}
+
+// doubles represent every integer in this range exactly
+static constexpr auto max_exact_integer = double(i64{ 1 } << 53);
+
+[[nodiscard]] Optional<i64> JsonValue::as_integer() const {
+    const auto value = as_number();
+    if (not value or std::trunc(*value) != *value or std::abs(*value) > max_exact_integer) {
+        return {};
+    }
+    return static_cast<i64>(*value);
+}
+
+[[nodiscard]] Optional<std::string_view> JsonValue::as_string() const {
+    if (const auto value = std::get_if<std::string>(&m_value)) {
+        return std::string_view{ *value };
+    }
+    return {};
+}
+
+[[nodiscard]] const JsonArray* JsonValue::as_array() const {
+    return std::get_if<JsonArray>(&m_value);
+}
+
+[[nodiscard]] const JsonObject* JsonValue::as_object() const {
+    return std::get_if<JsonObject>(&m_value);
+}
+
+[[nodiscard]] const JsonValue* JsonValue::member(const std::string_view name) const {
+    const auto object = as_object();
+    if (object == nullptr) {
+        return nullptr;
+    }
+    for (const auto& member : *object) {
+        if (member.name == name) {
+            return &member.value;
+        }
+    }
+    return nullptr;
+}
+
+[[nodiscard]] const JsonValue* JsonValue::member_at(const std::initializer_list<std::string_view> names) const {
+    auto result = this;
+    for (const auto name : names) {
+        if (result == nullptr) {
+            break;
+        }
+        result = result->member(name);
+    }
+    return result;
+}
+
+void append_json_string(std::string& output, const std::string_view string) {
+    output += '"';
+    for (const auto c : string) {
+        switch (c) {
+            case '"':
+                output += "\\\"";
+                break;
+            case '\\':
+                output += "\\\\";
+                break;
+            case '\n':
+                output += "\\n";
+                break;
+            case '\r':
+                output += "\\r";
+                break;
+            case '\t':
+                output += "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    fmt::format_to(std::back_inserter(output), "\\u{:04x}", static_cast<unsigned char>(c));
+                } else {
+                    output += c;
+                }
+                break;
+        }
+    }
+    output += '"';
+}
+
+void JsonValue::append_to(std::string& output) const {
+    if (is_null()) {
+        output += "null";
+    } else if (const auto boolean = std::get_if<bool>(&m_value)) {
+        output += (*boolean ? "true" : "false");
+    } else if (const auto integer = as_integer()) {
+        fmt::format_to(std::back_inserter(output), "{}", *integer);
+    } else if (const auto number = std::get_if<double>(&m_value)) {
+        // JSON has neither infinities nor NaN
+        if (std::isfinite(*number)) {
+            fmt::format_to(std::back_inserter(output), "{}", *number);
+        } else {
+            output += "null";
+        }
+    } else if (const auto string = std::get_if<std::string>(&m_value)) {
+        append_json_string(output, *string);
+    } else if (const auto array = as_array()) {
+        output += '[';
+        for (usize i = 0; i < array->size(); ++i) {
+            if (i > 0) {
+                output += ',';
+            }
+            (*array)[i].append_to(output);
+        }
+        output += ']';
+    } else {
+        const auto& object = std::get<JsonObject>(m_value);
+        output += '{';
+        for (usize i = 0; i < object.size(); ++i) {
+            if (i > 0) {
+                output += ',';
+            }
+            append_json_string(output, object[i].name);
+            output += ':';
+            object[i].value.append_to(output);
+        }
+        output += '}';
+    }
+}
+
+[[nodiscard]] std::string JsonValue::to_string() const {
+    auto result = std::string{};
+    append_to(result);
+    return result;
+}
+
+[[nodiscard]] bool JsonValue::operator==(const JsonValue& other) const {
+    return m_value == other.m_value;
+}
+
+// deeper values are rejected instead of overflowing the stack
+static constexpr usize max_json_depth = 256;
+
+struct JsonParser final {
+private:
+    std::string_view m_text;
+    usize m_index{ 0 };
+
+public:
+    explicit JsonParser(const std::string_view text) : m_text{ text } { }
+
+    [[nodiscard]] Optional<JsonValue> document() {
+        auto result = value(0);
+        skip_whitespace();
+        if (m_index != m_text.length()) {
+            return {};
+        }
+        return result;
+    }
+
+private:
+    [[nodiscard]] bool is_end_of_input() const {
+        return m_index >= m_text.length();
+    }
+
+    [[nodiscard]] char current() const {
+        return is_end_of_input() ? '\0' : m_text[m_index];
+    }
+
+    void skip_whitespace() {
+        while (not is_end_of_input()
+               and (current() == ' ' or current() == '\t' or current() == '\n' or current() == '\r')) {
+            ++m_index;
+        }
+    }
+
+    [[nodiscard]] bool consume(const char expected) {
+        skip_whitespace();
+        if (current() != expected) {
+            return false;
+        }
+        ++m_index;
+        return true;
+    }
+
+    [[nodiscard]] bool consume_literal(const std::string_view literal) {
+        if (not m_text.substr(m_index).starts_with(literal)) {
+            return false;
+        }
+        m_index += literal.length();
+        return true;
+    }
+
+    [[nodiscard]] Optional<JsonValue> value(const usize depth) {
+        if (depth > max_json_depth) {
+            return {};
+        }
+        skip_whitespace();
+        switch (current()) {
+            case 'n':
+                return consume_literal("null") ? Optional<JsonValue>{ JsonValue{} } : Optional<JsonValue>{};
+            case 't':
+                return consume_literal("true") ? Optional<JsonValue>{ JsonValue{ true } } : Optional<JsonValue>{};
+            case 'f':
+                return consume_literal("false") ? Optional<JsonValue>{ JsonValue{ false } } : Optional<JsonValue>{};
+            case '"': {
+                auto result = string();
+                if (not result) {
+                    return {};
+                }
+                return JsonValue{ std::move(*result) };
+            }
+            case '[':
+                return array(depth);
+            case '{':
+                return object(depth);
+            default:
+                return number();
+        }
+    }
+
+    [[nodiscard]] Optional<JsonValue> number() {
+        // from_chars would also accept things like "inf" and "nan"
+        if (current() != '-' and (current() < '0' or current() > '9')) {
+            return {};
+        }
+        auto result = 0.0;
+        const auto begin = m_text.data() + m_index;
+        const auto [end, error] = std::from_chars(begin, m_text.data() + m_text.length(), result);
+        if (error != std::errc{}) {
+            return {};
+        }
+        m_index += static_cast<usize>(end - begin);
+        return JsonValue{ result };
+    }
+
+    [[nodiscard]] Optional<u32> hex_digits() {
+        if (m_text.length() - m_index < 4) {
+            return {};
+        }
+        auto result = u32{ 0 };
+        const auto begin = m_text.data() + m_index;
+        const auto [end, error] = std::from_chars(begin, begin + 4, result, 16);
+        if (error != std::errc{} or end != begin + 4) {
+            return {};
+        }
+        m_index += 4;
+        return result;
+    }
+
+    static void append_utf8(std::string& output, const u32 codepoint) {
+        if (codepoint < 0x80) {
+            output += static_cast<char>(codepoint);
+        } else if (codepoint < 0x800) {
+            output += static_cast<char>(0xC0 | (codepoint >> 6));
+            output += static_cast<char>(0x80 | (codepoint & 0x3F));
+        } else if (codepoint < 0x10000) {
+            output += static_cast<char>(0xE0 | (codepoint >> 12));
+            output += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+            output += static_cast<char>(0x80 | (codepoint & 0x3F));
+        } else {
+            output += static_cast<char>(0xF0 | (codepoint >> 18));
+            output += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+            output += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+            output += static_cast<char>(0x80 | (codepoint & 0x3F));
+        }
+    }
+
+    // characters outside of the basic multilingual plane are escaped as surrogate pairs
+    [[nodiscard]] Optional<u32> escaped_codepoint() {
+        const auto high = hex_digits();
+        if (not high or (*high >= 0xDC00 and *high < 0xE000)) {
+            return {};
+        }
+        if (*high < 0xD800 or *high >= 0xDC00) {
+            return high;
+        }
+        if (not consume_literal("\\u")) {
+            return {};
+        }
+        const auto low = hex_digits();
+        if (not low or *low < 0xDC00 or *low >= 0xE000) {
+            return {};
+        }
+        return 0x10000 + ((*high - 0xD800) << 10) + (*low - 0xDC00);
+    }
+
+    [[nodiscard]] Optional<std::string> string() {
+        if (not consume('"')) {
+            return {};
+        }
+        auto result = std::string{};
+        while (not is_end_of_input()) {
+            const auto c = m_text[m_index++];
+            if (c == '"') {
+                return result;
+            }
+            if (static_cast<unsigned char>(c) < 0x20) {
+                return {};
+            }
+            if (c != '\\') {
+                result += c;
+                continue;
+            }
+            if (is_end_of_input()) {
+                return {};
+            }
+            switch (m_text[m_index++]) {
+                case '"':
+                    result += '"';
+                    break;
+                case '\\':
+                    result += '\\';
+                    break;
+                case '/':
+                    result += '/';
+                    break;
+                case 'b':
+                    result += '\b';
+                    break;
+                case 'f':
+                    result += '\f';
+                    break;
+                case 'n':
+                    result += '\n';
+                    break;
+                case 'r':
+                    result += '\r';
+                    break;
+                case 't':
+                    result += '\t';
+                    break;
+                case 'u': {
+                    const auto codepoint = escaped_codepoint();
+                    if (not codepoint) {
+                        return {};
+                    }
+                    append_utf8(result, *codepoint);
+                    break;
+                }
+                default:
+                    return {};
+            }
+        }
+        return {};
+    }
+
+    [[nodiscard]] Optional<JsonValue> array(const usize depth) {
+        std::ignore = consume('[');
+        auto result = JsonArray{};
+        if (consume(']')) {
+            return JsonValue{ std::move(result) };
+        }
+        do {
+            auto element = value(depth + 1);
+            if (not element) {
+                return {};
+            }
+            result.push_back(std::move(*element));
+        } while (consume(','));
+        if (not consume(']')) {
+            return {};
+        }
+        return JsonValue{ std::move(result) };
+    }
+
+    [[nodiscard]] Optional<JsonValue> object(const usize depth) {
+        std::ignore = consume('{');
+        auto result = JsonObject{};
+        if (consume('}')) {
+            return JsonValue{ std::move(result) };
+        }
+        do {
+            auto name = string();
+            if (not name or not consume(':')) {
+                return {};
+            }
+            auto member_value = value(depth + 1);
+            if (not member_value) {
+                return {};
+            }
+            result.push_back(JsonMember{ std::move(*name), std::move(*member_value) });
+        } while (consume(','));
+        if (not consume('}')) {
+            return {};
+        }
+        return JsonValue{ std::move(result) };
+    }
+};
+
+[[nodiscard]] Optional<JsonValue> parse_json(const std::string_view text) {
+    return JsonParser{ text }.document();
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "types.hpp"
+#include <concepts>
+#include <cstddef>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+struct JsonValue;
+struct JsonMember;
+
+using JsonArray = std::vector<JsonValue>;
+// the members keep their order, so the output is the same for every run
+using JsonObject = std::vector<JsonMember>;
+
+// A JSON value as it is exchanged with a language server client. Numbers are doubles, like in JavaScript.
+struct JsonValue final {
+private:
+    std::variant<std::nullptr_t, bool, double, std::string, JsonArray, JsonObject> m_value;
+
+public:
+    JsonValue() : m_value{ nullptr } { }
+    JsonValue(std::nullptr_t) : m_value{ nullptr } { }
+    JsonValue(const bool value) : m_value{ value } { }
+    JsonValue(const double value) : m_value{ value } { }
+
+    template<std::integral T>
+    requires(not std::same_as<T, bool>)
+    JsonValue(const T value) : m_value{ static_cast<double>(value) } { }
+
+    JsonValue(std::string value) : m_value{ std::move(value) } { }
+    JsonValue(const std::string_view value) : m_value{ std::string{ value } } { }
+    JsonValue(const char* const value) : m_value{ std::string{ value } } { }
+    JsonValue(JsonArray value);
+    JsonValue(JsonObject value);
+
+    [[nodiscard]] bool is_null() const {
+        return std::holds_alternative<std::nullptr_t>(m_value);
+    }
+
+    [[nodiscard]] Optional<bool> as_bool() const;
+    [[nodiscard]] Optional<double> as_number() const;
+    // only for numbers without a fractional part that fit into an i64
+    [[nodiscard]] Optional<i64> as_integer() const;
+    [[nodiscard]] Optional<std::string_view> as_string() const;
+    [[nodiscard]] const JsonArray* as_array() const;
+    [[nodiscard]] const JsonObject* as_object() const;
+
+    // the value of the member with the given name, or nullptr if there is none (or if this is not an object)
+    [[nodiscard]] const JsonValue* member(std::string_view name) const;
+
+    // the value of a path of members, e.g. member_at({ "textDocument", "uri" })
+    [[nodiscard]] const JsonValue* member_at(std::initializer_list<std::string_view> names) const;
+
+    [[nodiscard]] std::string to_string() const;
+    void append_to(std::string& output) const;
+
+    [[nodiscard]] bool operator==(const JsonValue& other) const;
+};
+
+struct JsonMember final {
+    std::string name;
+    JsonValue value;
+
+    [[nodiscard]] bool operator==(const JsonMember& other) const = default;
+};
+
+// appends the string in quotes, with everything escaped that JSON requires to be escaped
+void append_json_string(std::string& output, std::string_view string);
+
+// returns nothing if the text is not exactly one JSON value (surrounded by whitespace)
+[[nodiscard]] Optional<JsonValue> parse_json(std::string_view text);
@@ -0,0 +1,822 @@
+#include "language_server.hpp"
+#include "json.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "source_buffer.hpp"
+#include "source_files.hpp"
+#include "statistics.hpp"
+#include "version.hpp"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <fmt/format.h>
+#include <magic_enum.hpp>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+using namespace parser_nodes;
+
+using Clock = std::chrono::steady_clock;
+
+// changed documents are only analyzed once the client has stopped changing them for this long
+static constexpr auto debounce_delay = std::chrono::milliseconds{ 150 };
+
+// the latencies of the diagnostics are measured from the first change they include
+static constexpr auto diagnostics_method = std::string_view{ "textDocument/publishDiagnostics" };
+
+enum class LspErrorCode : i32 {
+    ParseError = -32700,
+    InvalidRequest = -32600,
+    MethodNotFound = -32601,
+    InvalidParams = -32602,
+    ServerNotInitialized = -32002,
+    RequestCancelled = -32800,
+};
+
+enum class SymbolKind : i32 {
+    Module = 2,
+    Function = 12,
+    TypeParameter = 26,
+};
+
+// what the "character" of a position counts, UTF-16 code units unless the client supports UTF-8
+enum class PositionEncoding {
+    Utf8,
+    Utf16,
+};
+
+// the offsets of the first characters of all lines
+[[nodiscard]] static std::vector<usize> line_starts(const std::string_view text) {
+    auto result = std::vector<usize>{ 0 };
+    for (usize i = 0; i < text.length(); ++i) {
+        if (text[i] == '\n') {
+            result.push_back(i + 1);
+        }
+    }
+    return result;
+}
+
+[[nodiscard]] static usize utf8_sequence_length(const char lead_byte) {
+    const auto byte = static_cast<unsigned char>(lead_byte);
+    if (byte >= 0xF0) {
+        return 4;
+    }
+    if (byte >= 0xE0) {
+        return 3;
+    }
+    if (byte >= 0xC0) {
+        return 2;
+    }
+    return 1;
+}
+
+// codepoints outside of the basic multilingual plane take up two UTF-16 code units
+[[nodiscard]] static usize num_code_units(const std::string_view text, const PositionEncoding encoding) {
+    if (encoding == PositionEncoding::Utf8) {
+        return text.length();
+    }
+    auto result = usize{ 0 };
+    for (const auto c : text) {
+        if ((static_cast<unsigned char>(c) & 0xC0) != 0x80) {
+            result += (utf8_sequence_length(c) == 4 ? 2 : 1);
+        }
+    }
+    return result;
+}
+
+// converts between byte offsets into a text and the positions of the protocol (line and character within the line)
+struct TextPositions final {
+private:
+    std::string_view m_text;
+    const std::vector<usize>& m_line_starts;
+    PositionEncoding m_encoding;
+
+public:
+    TextPositions(const std::string_view text, const std::vector<usize>& line_starts, const PositionEncoding encoding)
+        : m_text{ text },
+          m_line_starts{ line_starts },
+          m_encoding{ encoding } { }
+
+    [[nodiscard]] JsonValue position(const usize offset) const {
+        const auto next_line = std::ranges::upper_bound(m_line_starts, offset);
+        const auto line = static_cast<usize>(next_line - m_line_starts.begin()) - 1;
+        const auto line_start = m_line_starts[line];
+        const auto character = num_code_units(m_text.substr(line_start, offset - line_start), m_encoding);
+        return JsonObject{ { "line", line }, { "character", character } };
+    }
+
+    [[nodiscard]] JsonValue range(const usize begin, const usize end) const {
+        return JsonObject{ { "start", position(begin) }, { "end", position(end) } };
+    }
+
+    // the tokens are part of the section, so their offsets are shifted into the current text
+    [[nodiscard]] JsonValue range(const PlacedSection& section, const Token& first, const Token& last) const {
+        return range(section.offset(first.offset()), section.offset(last.offset()) + last.length());
+    }
+
+    [[nodiscard]] std::string_view text(const PlacedSection& section, const Token& first, const Token& last) const {
+        const auto begin = section.offset(first.offset());
+        return m_text.substr(begin, section.offset(last.offset()) + last.length() - begin);
+    }
+
+    // positions behind the end of a line are at its end, the ones behind the last line at the end of the text
+    [[nodiscard]] Optional<usize> offset(const JsonValue& position) const {
+        const auto line_value = position.member("line");
+        const auto character_value = position.member("character");
+        const auto line = (line_value != nullptr ? line_value->as_integer() : Optional<i64>{});
+        const auto character = (character_value != nullptr ? character_value->as_integer() : Optional<i64>{});
+        if (not line or not character or *line < 0 or *character < 0) {
+            return {};
+        }
+        if (static_cast<usize>(*line) >= m_line_starts.size()) {
+            return m_text.length();
+        }
+        const auto line_index = static_cast<usize>(*line);
+        auto line_end = (line_index + 1 < m_line_starts.size() ? m_line_starts[line_index + 1] - 1 : m_text.length());
+        if (line_end > m_line_starts[line_index] and line_end < m_text.length() and m_text[line_end - 1] == '\r') {
+            --line_end;
+        }
+        auto result = m_line_starts[line_index];
+        auto num_units = usize{ 0 };
+        while (result < line_end) {
+            const auto length = utf8_sequence_length(m_text[result]);
+            const auto units = (m_encoding == PositionEncoding::Utf16 and length == 4 ? usize{ 2 } : usize{ 1 });
+            if (num_units + units > static_cast<usize>(*character)) {
+                break;
+            }
+            num_units += units;
+            result = std::min(result + (m_encoding == PositionEncoding::Utf8 ? 1 : length), line_end);
+        }
+        return result;
+    }
+};
+
+// the smallest edit that turns the previous text into the current one
+[[nodiscard]] static TextEdit text_edit(const std::string_view previous, const std::string_view current) {
+    const auto max_common_length = std::min(previous.length(), current.length());
+    auto prefix_length = usize{ 0 };
+    while (prefix_length < max_common_length and previous[prefix_length] == current[prefix_length]) {
+        ++prefix_length;
+    }
+    auto suffix_length = usize{ 0 };
+    while (suffix_length < max_common_length - prefix_length
+           and previous[previous.length() - suffix_length - 1] == current[current.length() - suffix_length - 1]) {
+        ++suffix_length;
+    }
+    return TextEdit{ prefix_length, previous.length() - prefix_length - suffix_length,
+                     current.length() - prefix_length - suffix_length };
+}
+
+[[nodiscard]] static std::u8string_view to_u8string_view(const std::string_view string) {
+    return std::u8string_view{ reinterpret_cast<const char8_t*>(string.data()), string.length() };
+}
+
+// The source file of an open document. Every analysis replaces its contents with the current text, so a document
+// only takes up a single entry of the SourceFiles table, which is removed once its last analysis is gone.
+struct DocumentFile final {
+private:
+    FileId m_file_id;
+
+public:
+    explicit DocumentFile(const FileId file_id) : m_file_id{ file_id } { }
+
+    DocumentFile(const DocumentFile&) = delete;
+    DocumentFile& operator=(const DocumentFile&) = delete;
+
+    ~DocumentFile() {
+        SourceFiles::remove(m_file_id);
+    }
+
+    [[nodiscard]] FileId file_id() const {
+        return m_file_id;
+    }
+};
+
+// a version of a document that could be tokenized, the next versions are parsed incrementally from it
+struct ParsedVersion final {
+    std::string text;
+    IncrementalProgram program;
+};
+
+// everything the client can ask for about one version of a document is determined right away
+struct Analysis final {
+    std::shared_ptr<const DocumentFile> file;
+    // the analyzed version, or the last one before it that could be tokenized
+    std::shared_ptr<const ParsedVersion> parsed;
+    JsonValue diagnostics;
+    JsonValue symbols;
+};
+
+[[nodiscard]] static JsonValue
+diagnostic(const TextPositions& positions, const usize offset, const usize length, std::string message) {
+    return JsonObject{
+        { "range", positions.range(offset, offset + length) },
+        { "severity", 1 },
+        { "source", "seatbelt2" },
+        { "message", std::move(message) },
+    };
+}
+
+[[nodiscard]] static JsonValue document_symbol(
+        const std::string_view name,
+        const SymbolKind kind,
+        JsonValue range,
+        JsonValue selection_range,
+        JsonArray children = {}
+) {
+    return JsonObject{
+        { "name", name },
+        { "kind", std::to_underlying(kind) },
+        { "range", std::move(range) },
+        { "selectionRange", std::move(selection_range) },
+        { "children", std::move(children) },
+    };
+}
+
+[[nodiscard]] static JsonArray function_symbols(
+        const TextPositions& positions,
+        const PlacedSection& section,
+        const std::span<const Statement* const> statements
+) {
+    auto result = JsonArray{};
+    for (const auto statement : statements) {
+        const auto definition = dynamic_cast<const FunctionDefinition*>(statement);
+        if (definition == nullptr) {
+            continue;
+        }
+        auto children = JsonArray{};
+        if (definition->type_parameters) {
+            for (const auto& identifier : definition->type_parameters->identifiers) {
+                const auto range = positions.range(section, identifier, identifier);
+                children.push_back(document_symbol(
+                        positions.text(section, identifier, identifier), SymbolKind::TypeParameter, range, range
+                ));
+            }
+        }
+        for (auto& nested : function_symbols(positions, section, definition->body.statements)) {
+            children.push_back(std::move(nested));
+        }
+        const auto first_token = definition->export_token.value_or(definition->function_keyword);
+        result.push_back(document_symbol(
+                positions.text(section, definition->identifier, definition->identifier), SymbolKind::Function,
+                positions.range(section, first_token, definition->body.right_curly_brace),
+                positions.range(section, definition->identifier, definition->identifier), std::move(children)
+        ));
+    }
+    return result;
+}
+
+// like a Program, the symbols are only there if the whole text could be parsed
+[[nodiscard]] static JsonValue document_symbols(const IncrementalProgram& program, const TextPositions& positions) {
+    const auto has_errors = [](const PlacedSection& placed) { return not placed.section->errors.empty(); };
+    if (std::ranges::any_of(program.sections, has_errors)) {
+        return JsonArray{};
+    }
+    auto result = JsonArray{};
+    const auto& imports_section = program.sections.front();
+    for (const auto& import : imports_section.section->imports) {
+        const auto& name = import.module_name.tokens;
+        result.push_back(document_symbol(
+                positions.text(imports_section, name.front(), name.back()), SymbolKind::Module,
+                positions.range(imports_section, import.import_token, import.semicolon_token),
+                positions.range(imports_section, name.front(), name.back())
+        ));
+    }
+    for (const auto& section : std::span{ program.sections }.subspan(1)) {
+        const auto definition = std::span{ &section.section->definition, 1 };
+        for (auto& symbol : function_symbols(positions, section, definition)) {
+            result.push_back(std::move(symbol));
+        }
+    }
+    return result;
+}
+
+// Tokenizes and parses the text, incrementally if there is a previous version that could be tokenized. The text
+// replaces the contents of the document's source file, so only the offsets of the previous tokens and nodes are used
+// from then on (not their lexemes). Returns nothing if the document is new and there are too many source files.
+[[nodiscard]] static std::shared_ptr<const Analysis> analyze(
+        const std::string& uri,
+        std::string text,
+        const Analysis* const previous,
+        const PositionEncoding encoding
+) {
+    auto result = std::make_shared<Analysis>();
+    auto source_code = SourceBuffer::from_string(to_u8string_view(text));
+    if (previous != nullptr) {
+        SourceFiles::replace(previous->file->file_id(), std::move(source_code));
+        result->file = previous->file;
+    } else {
+        const auto new_file_id = SourceFiles::add(uri, std::move(source_code));
+        if (not new_file_id) {
+            return nullptr;
+        }
+        result->file = std::make_shared<const DocumentFile>(*new_file_id);
+    }
+    const auto text_line_starts = line_starts(text);
+    const auto positions = TextPositions{ text, text_line_starts, encoding };
+
+    const auto parsed = (previous != nullptr ? previous->parsed : nullptr);
+    auto program = (parsed != nullptr ? reparse(parsed->program, text_edit(parsed->text, text))
+                                      : parse_incrementally(result->file->file_id()));
+    if (not program) {
+        const auto& location = program.error().location;
+        const auto message = std::string{ magic_enum::enum_name(program.error().error_code) };
+        result->diagnostics = JsonArray{ diagnostic(positions, location.offset(), location.length(), message) };
+        result->symbols = JsonArray{};
+        result->parsed = parsed;
+        return result;
+    }
+
+    auto diagnostics = JsonArray{};
+    for (const auto& section : program->sections) {
+        for (const auto& error : section.section->errors) {
+            auto message = std::string{ magic_enum::enum_name(error.error_code) };
+            if (error.expected) {
+                message += fmt::format(" (expected {})", magic_enum::enum_name(*error.expected));
+            }
+            const auto offset = section.offset(error.location.offset());
+            diagnostics.push_back(diagnostic(positions, offset, error.location.length(), std::move(message)));
+        }
+    }
+    result->diagnostics = std::move(diagnostics);
+    result->symbols = document_symbols(*program, positions);
+    result->parsed = std::make_shared<const ParsedVersion>(std::move(text), std::move(*program));
+    return result;
+}
+
+// messages can't be longer than this, so a broken header can't make the server allocate all of its memory
+static constexpr auto max_content_length = usize{ 64 } * 1024 * 1024;
+
+enum class ReadError {
+    EndOfInput,
+    // the content has been skipped
+    TooLong,
+};
+
+// reads the header and the content of the next message
+[[nodiscard]] static Result<std::string, ReadError> read_message(std::FILE* const input) {
+    static constexpr auto content_length_header = std::string_view{ "Content-Length:" };
+    auto content_length = Optional<usize>{};
+    auto line = std::string{};
+    while (true) {
+        line.clear();
+        auto c = std::fgetc(input);
+        for (; c != EOF and c != '\n'; c = std::fgetc(input)) {
+            line += static_cast<char>(c);
+        }
+        if (c == EOF) {
+            return Error<ReadError>{ ReadError::EndOfInput };
+        }
+        if (line.ends_with('\r')) {
+            line.pop_back();
+        }
+        if (line.empty()) {
+            break;
+        }
+        if (line.starts_with(content_length_header)) {
+            auto value = std::string_view{ line }.substr(content_length_header.length());
+            while (value.starts_with(' ')) {
+                value.remove_prefix(1);
+            }
+            auto length = usize{ 0 };
+            const auto [end, error] = std::from_chars(value.data(), value.data() + value.length(), length);
+            if (error == std::errc{} and end == value.data() + value.length()) {
+                content_length = length;
+            }
+        }
+    }
+    // without a length, the end of the message cannot be found
+    if (not content_length) {
+        return Error<ReadError>{ ReadError::EndOfInput };
+    }
+    if (*content_length > max_content_length) {
+        auto buffer = std::array<char, 64 * 1024>{};
+        for (auto remaining = *content_length; remaining > 0;) {
+            const auto num_read = std::fread(buffer.data(), 1, std::min(remaining, buffer.size()), input);
+            if (num_read == 0) {
+                return Error<ReadError>{ ReadError::EndOfInput };
+            }
+            remaining -= num_read;
+        }
+        return Error<ReadError>{ ReadError::TooLong };
+    }
+    auto content = std::string(*content_length, '\0');
+    if (std::fread(content.data(), 1, content.length(), input) != content.length()) {
+        return Error<ReadError>{ ReadError::EndOfInput };
+    }
+    return content;
+}
+
+struct PendingRequest final {
+    JsonValue id;
+    std::string method;
+    std::string uri;
+    Clock::time_point received_at;
+};
+
+struct Document final {
+    std::string text;
+    std::vector<usize> line_starts;
+    i64 version;
+    // the current text is analyzed as soon as a request needs it, or at analyze_at
+    bool is_analyzed{ false };
+    Clock::time_point analyze_at;
+    // the first change that is not part of the analysis yet
+    Clock::time_point changed_at;
+    std::shared_ptr<const Analysis> analysis;
+};
+
+struct LanguageServer final {
+private:
+    std::FILE* m_output;
+    std::mutex m_output_mutex;
+
+    // the message loop and the worker share everything below, m_output_mutex is always locked last
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    PositionEncoding m_encoding{ PositionEncoding::Utf16 };
+    std::unordered_map<std::string, Document> m_documents;
+    std::deque<PendingRequest> m_requests;
+    std::map<std::string, LatencyHistogram, std::less<>> m_latencies;
+    bool m_stopping{ false };
+    std::thread m_worker;
+
+public:
+    explicit LanguageServer(std::FILE* const output) : m_output{ output }, m_worker{ [this]() { work(); } } { }
+
+    LanguageServer(const LanguageServer&) = delete;
+    LanguageServer& operator=(const LanguageServer&) = delete;
+
+    ~LanguageServer() {
+        {
+            const auto lock = std::scoped_lock{ m_mutex };
+            m_stopping = true;
+        }
+        m_condition.notify_all();
+        m_worker.join();
+    }
+
+    [[nodiscard]] int run(std::FILE* const input) {
+        auto is_initialized = false;
+        auto is_shut_down = false;
+        while (true) {
+            const auto content = read_message(input);
+            if (not content and content.error() == ReadError::TooLong) {
+                send_error(JsonValue{}, LspErrorCode::ParseError, "the message is too long");
+                continue;
+            }
+            // the client has to shut down the server before closing the input
+            if (not content) {
+                return EXIT_FAILURE;
+            }
+            const auto received_at = Clock::now();
+            const auto message = parse_json(*content);
+            if (not message or message->as_object() == nullptr) {
+                send_error(JsonValue{}, LspErrorCode::ParseError, "invalid JSON");
+                continue;
+            }
+            const auto method_value = message->member("method");
+            const auto method = (method_value != nullptr ? method_value->as_string() : Optional<std::string_view>{});
+            // the server doesn't send any requests, so there are no responses to handle
+            if (not method) {
+                continue;
+            }
+            const auto id = message->member("id");
+            const auto params = message->member("params");
+            const auto empty_params = JsonValue{ JsonObject{} };
+            const auto& parameters = (params != nullptr ? *params : empty_params);
+
+            if (*method == "exit") {
+                return is_shut_down ? EXIT_SUCCESS : EXIT_FAILURE;
+            }
+            if (not is_initialized and *method != "initialize") {
+                if (id != nullptr) {
+                    send_error(*id, LspErrorCode::ServerNotInitialized, "the server has not been initialized");
+                }
+                continue;
+            }
+            if (is_shut_down) {
+                if (id != nullptr) {
+                    send_error(*id, LspErrorCode::InvalidRequest, "the server has been shut down");
+                }
+                continue;
+            }
+
+            if (*method == "initialize" and id != nullptr) {
+                send_result(*id, initialize(parameters));
+                is_initialized = true;
+            } else if (*method == "shutdown" and id != nullptr) {
+                send_result(*id, JsonValue{});
+                is_shut_down = true;
+            } else if (*method == "textDocument/didOpen") {
+                open_document(parameters, received_at);
+            } else if (*method == "textDocument/didChange") {
+                change_document(parameters, received_at);
+            } else if (*method == "textDocument/didClose") {
+                close_document(parameters);
+            } else if (*method == "textDocument/documentSymbol" and id != nullptr) {
+                enqueue_request(*id, *method, parameters, received_at);
+                continue;
+            } else if (*method == "$/cancelRequest") {
+                cancel_request(parameters);
+            } else if (id != nullptr) {
+                send_error(*id, LspErrorCode::MethodNotFound, fmt::format("unsupported method {}", *method));
+            }
+            // other notifications (e.g. "initialized") need no reaction
+            const auto lock = std::scoped_lock{ m_mutex };
+            m_latencies[std::string{ *method }].record(Clock::now() - received_at);
+        }
+    }
+
+    [[nodiscard]] std::string latency_report() {
+        const auto lock = std::scoped_lock{ m_mutex };
+        auto result = std::string{};
+        for (const auto& [method, histogram] : m_latencies) {
+            result += fmt::format("{}: {}", method, histogram.to_string());
+        }
+        return result;
+    }
+
+private:
+    void send(const JsonValue& message) {
+        const auto content = message.to_string();
+        const auto lock = std::scoped_lock{ m_output_mutex };
+        fmt::print(m_output, "Content-Length: {}\r\n\r\n{}", content.length(), content);
+        std::fflush(m_output);
+    }
+
+    void send_result(const JsonValue& id, JsonValue result) {
+        send(JsonObject{ { "jsonrpc", "2.0" }, { "id", id }, { "result", std::move(result) } });
+    }
+
+    void send_error(const JsonValue& id, const LspErrorCode code, std::string message) {
+        send(JsonObject{
+                { "jsonrpc", "2.0" },
+                { "id", id },
+                { "error", JsonObject{ { "code", std::to_underlying(code) }, { "message", std::move(message) } } },
+        });
+    }
+
+    void send_notification(const std::string_view method, JsonValue params) {
+        send(JsonObject{ { "jsonrpc", "2.0" }, { "method", method }, { "params", std::move(params) } });
+    }
+
+    [[nodiscard]] JsonValue initialize(const JsonValue& parameters) {
+        auto encoding = PositionEncoding::Utf16;
+        if (const auto encodings = parameters.member_at({ "capabilities", "general", "positionEncodings" })) {
+            if (const auto array = encodings->as_array()) {
+                if (std::ranges::find(*array, JsonValue{ "utf-8" }) != array->end()) {
+                    encoding = PositionEncoding::Utf8;
+                }
+            }
+        }
+        {
+            const auto lock = std::scoped_lock{ m_mutex };
+            m_encoding = encoding;
+        }
+        return JsonObject{
+            { "capabilities",
+              JsonObject{
+                      { "positionEncoding", encoding == PositionEncoding::Utf8 ? "utf-8" : "utf-16" },
+                      // incremental changes
+                      { "textDocumentSync", JsonObject{ { "openClose", true }, { "change", 2 } } },
+                      { "documentSymbolProvider", true },
+              } },
+            { "serverInfo", JsonObject{ { "name", "Seatbelt2" }, { "version", compiler_version } } },
+        };
+    }
+
+    [[nodiscard]] static Optional<std::string> document_uri(const JsonValue& parameters) {
+        const auto uri = parameters.member_at({ "textDocument", "uri" });
+        if (uri == nullptr or not uri->as_string()) {
+            return {};
+        }
+        return std::string{ *uri->as_string() };
+    }
+
+    void open_document(const JsonValue& parameters, const Clock::time_point received_at) {
+        const auto uri = document_uri(parameters);
+        const auto text = parameters.member_at({ "textDocument", "text" });
+        const auto version = parameters.member_at({ "textDocument", "version" });
+        if (not uri or text == nullptr or not text->as_string()) {
+            return;
+        }
+        auto document = Document{};
+        document.text = std::string{ *text->as_string() };
+        document.line_starts = line_starts(document.text);
+        document.version = (version != nullptr ? version->as_integer().value_or(0) : 0);
+        // there is nothing to wait for when a document is opened
+        document.analyze_at = received_at;
+        document.changed_at = received_at;
+        {
+            const auto lock = std::scoped_lock{ m_mutex };
+            m_documents.insert_or_assign(*uri, std::move(document));
+        }
+        m_condition.notify_all();
+    }
+
+    void change_document(const JsonValue& parameters, const Clock::time_point received_at) {
+        const auto uri = document_uri(parameters);
+        const auto version = parameters.member_at({ "textDocument", "version" });
+        const auto changes = parameters.member("contentChanges");
+        if (not uri or changes == nullptr or changes->as_array() == nullptr) {
+            return;
+        }
+        {
+            const auto lock = std::scoped_lock{ m_mutex };
+            const auto iterator = m_documents.find(*uri);
+            if (iterator == m_documents.end()) {
+                return;
+            }
+            auto& document = iterator->second;
+            for (const auto& change : *changes->as_array()) {
+                apply_change(document, change);
+            }
+            if (version != nullptr and version->as_integer()) {
+                document.version = *version->as_integer();
+            }
+            if (document.is_analyzed) {
+                document.changed_at = received_at;
+            }
+            document.is_analyzed = false;
+            document.analyze_at = received_at + debounce_delay;
+        }
+        m_condition.notify_all();
+    }
+
+    // a change replaces either a range of the text or all of it
+    void apply_change(Document& document, const JsonValue& change) const {
+        const auto text = change.member("text");
+        if (text == nullptr or not text->as_string()) {
+            return;
+        }
+        const auto range = change.member("range");
+        if (range == nullptr) {
+            document.text = std::string{ *text->as_string() };
+        } else {
+            const auto positions = TextPositions{ document.text, document.line_starts, m_encoding };
+            const auto start = range->member("start");
+            const auto end = range->member("end");
+            const auto begin_offset = (start != nullptr ? positions.offset(*start) : Optional<usize>{});
+            const auto end_offset = (end != nullptr ? positions.offset(*end) : Optional<usize>{});
+            if (not begin_offset or not end_offset or *end_offset < *begin_offset) {
+                return;
+            }
+            document.text.replace(*begin_offset, *end_offset - *begin_offset, *text->as_string());
+        }
+        document.line_starts = line_starts(document.text);
+    }
+
+    void close_document(const JsonValue& parameters) {
+        const auto uri = document_uri(parameters);
+        if (not uri) {
+            return;
+        }
+        // under the lock, so that the worker cannot publish diagnostics for the document afterwards
+        const auto lock = std::scoped_lock{ m_mutex };
+        if (m_documents.erase(*uri) > 0) {
+            send_notification(diagnostics_method, JsonObject{ { "uri", *uri }, { "diagnostics", JsonArray{} } });
+        }
+    }
+
+    void enqueue_request(
+            const JsonValue& id,
+            const std::string_view method,
+            const JsonValue& parameters,
+            const Clock::time_point received_at
+    ) {
+        const auto uri = document_uri(parameters);
+        if (not uri) {
+            send_error(id, LspErrorCode::InvalidParams, "missing text document");
+            return;
+        }
+        {
+            const auto lock = std::scoped_lock{ m_mutex };
+            m_requests.push_back(PendingRequest{ id, std::string{ method }, *uri, received_at });
+        }
+        m_condition.notify_all();
+    }
+
+    void cancel_request(const JsonValue& parameters) {
+        const auto id = parameters.member("id");
+        if (id == nullptr) {
+            return;
+        }
+        const auto lock = std::scoped_lock{ m_mutex };
+        const auto iterator = std::ranges::find(m_requests, *id, &PendingRequest::id);
+        if (iterator != m_requests.end()) {
+            send_error(*id, LspErrorCode::RequestCancelled, "the request has been cancelled");
+            m_requests.erase(iterator);
+        }
+    }
+
+    // Analyzes the current text of the document unless that has already happened. The lock is released during the
+    // analysis, so the message loop can go on.
+    [[nodiscard]] std::shared_ptr<const Analysis>
+    analyzed_document(std::unique_lock<std::mutex>& lock, const std::string& uri) {
+        auto iterator = m_documents.find(uri);
+        if (iterator == m_documents.end()) {
+            return nullptr;
+        }
+        if (iterator->second.is_analyzed) {
+            return iterator->second.analysis;
+        }
+        iterator->second.is_analyzed = true;
+        auto text = iterator->second.text;
+        const auto version = iterator->second.version;
+        const auto changed_at = iterator->second.changed_at;
+        const auto previous = iterator->second.analysis;
+        const auto encoding = m_encoding;
+
+        lock.unlock();
+        const auto analysis = analyze(uri, std::move(text), previous.get(), encoding);
+        lock.lock();
+
+        // there can only be too many source files if there are thousands of open documents
+        if (analysis == nullptr) {
+            return previous;
+        }
+        // the document may have been closed (or changed) in the meantime
+        iterator = m_documents.find(uri);
+        if (iterator == m_documents.end()) {
+            return analysis;
+        }
+        iterator->second.analysis = analysis;
+        send_notification(
+                diagnostics_method,
+                JsonObject{ { "uri", uri }, { "version", version }, { "diagnostics", analysis->diagnostics } }
+        );
+        m_latencies[std::string{ diagnostics_method }].record(Clock::now() - changed_at);
+        return analysis;
+    }
+
+    // the document whose analysis is due first
+    [[nodiscard]] Optional<std::pair<std::string, Clock::time_point>> next_analysis() const {
+        auto result = Optional<std::pair<std::string, Clock::time_point>>{};
+        for (const auto& [uri, document] : m_documents) {
+            if (not document.is_analyzed and (not result or document.analyze_at < result->second)) {
+                result = std::pair{ uri, document.analyze_at };
+            }
+        }
+        return result;
+    }
+
+    // requests are answered first, in the order they have been received
+    void work() {
+        auto lock = std::unique_lock{ m_mutex };
+        while (not m_stopping) {
+            if (not m_requests.empty()) {
+                const auto request = std::move(m_requests.front());
+                m_requests.pop_front();
+                const auto analysis = analyzed_document(lock, request.uri);
+                send_result(request.id, analysis != nullptr ? analysis->symbols : JsonValue{});
+                m_latencies[request.method].record(Clock::now() - request.received_at);
+                continue;
+            }
+            const auto next = next_analysis();
+            if (not next) {
+                m_condition.wait(lock);
+            } else if (next->second > Clock::now()) {
+                m_condition.wait_until(lock, next->second);
+            } else {
+                std::ignore = analyzed_document(lock, next->first);
+            }
+        }
+    }
+};
+
+[[nodiscard]] int run_language_server(std::FILE* const input, std::FILE* const output, const bool time_report) {
+#if defined(_WIN32)
+    // the content length counts bytes, so there must not be any newline conversions
+    _setmode(_fileno(input), _O_BINARY);
+    _setmode(_fileno(output), _O_BINARY);
+#endif
+    auto exit_code = EXIT_SUCCESS;
+    auto report = std::string{};
+    {
+        auto server = LanguageServer{ output };
+        exit_code = server.run(input);
+        report = server.latency_report();
+    }
+    if (time_report) {
+        fmt::print(stderr, "{}", report);
+    }
+    return exit_code;
+}
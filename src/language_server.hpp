@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstdio>
+
+// Runs as language server (Language Server Protocol) on the given streams until the client sends the exit
+// notification or closes the input. The message loop only stores the documents the client sends. They are
+// analyzed on a background thread, incrementally from their previous version, once the client has stopped changing
+// them for a moment (or as soon as a request needs them). Diagnostics are published after every analysis and
+// document symbols are answered from the latest one. With a time report, a latency histogram per message type is
+// printed to stderr at the end. Returns the exit code that the protocol asks for.
+[[nodiscard]] int run_language_server(std::FILE* input, std::FILE* output, bool time_report);
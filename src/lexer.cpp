@@ -1,5 +1,7 @@
 #include "lexer.hpp"
 #include "fmt/core.h"
+#include "simd.hpp"
+#include <algorithm>
 #include <array>
 #include <cassert>
 
@@ -23,14 +25,10 @@ DISABLE_WARNING_POP
 #endif
 
 
-#include <range/v3/algorithm/find_if.hpp>
-#include <range/v3/core.hpp>
 #include <utility>
 
 using namespace std::string_view_literals;
 
-static constexpr char char_pattern[] = R"('(\\'|[ -\[\]-~]|\\[n\\tnvfr0])')";
-static constexpr char integer_pattern[] = "(0o([0-7]+_?)+)|(0x([\\dA-Fa-f]+_?)+)|(0b([01]+_?)+)|(\\d+_?)+";
 static constexpr char identifier_pattern[] = R"(\p{XID_Start}\p{XID_Continue}*)";
 
 static constexpr auto non_keyword_tokens = std::array{
@@ -101,17 +99,178 @@ static constexpr auto keywords = std::array{
     std::pair{    u8"restricted"sv,          TokenType::Restricted},
 };
 
+// perfect hash over the length and the first, second and last byte of a keyword
+[[nodiscard]] static constexpr u32 keyword_hash(const std::u8string_view word, const u32 seed) {
+    assert(not word.empty());
+    const auto second = word[word.length() > 1 ? 1 : 0];
+    auto hash = static_cast<u32>(word.length());
+    hash = hash * seed + word.front();
+    hash = hash * seed + second;
+    hash = hash * seed + word.back();
+    return hash;
+}
+
+struct KeywordTable final {
+    static constexpr usize size = 128;
+    static constexpr u32 max_seed = 10'000;
+
+    u32 seed{ 0 }; // 0 if no collision-free seed has been found
+    std::array<std::pair<std::u8string_view, TokenType>, size> entries{};
+
+    [[nodiscard]] constexpr usize index(const std::u8string_view word) const {
+        return keyword_hash(word, seed) % size;
+    }
+};
+
+// the seed is searched at compile time, new keywords only break the build if no collision-free seed exists
+static constexpr auto keyword_table = [] {
+    for (auto seed = u32{ 1 }; seed < KeywordTable::max_seed; ++seed) {
+        auto table = KeywordTable{ seed, {} };
+        auto collision_free = true;
+        for (const auto& keyword : keywords) {
+            auto& entry = table.entries[table.index(keyword.first)];
+            if (not entry.first.empty()) {
+                collision_free = false;
+                break;
+            }
+            entry = keyword;
+        }
+        if (collision_free) {
+            return table;
+        }
+    }
+    return KeywordTable{};
+}();
+
+static_assert(keyword_table.seed != 0, "no collision-free keyword hash found, increase KeywordTable::size");
+
+[[nodiscard]] static Optional<TokenType> find_keyword(const std::u8string_view identifier) {
+    const auto& [keyword, token_type] = keyword_table.entries[keyword_table.index(identifier)];
+    if (keyword == identifier) {
+        return token_type;
+    }
+    return {};
+}
+
+// classification of the first byte of a lexeme, used to jump directly to the matching sub-lexer
+enum class CharClass : u8 {
+    Invalid,
+    Whitespace,
+    Slash, // start of a comment or a forward slash
+    Punctuation,
+    Digit,
+    Quote,
+    AsciiLetter,
+    NonAscii,
+};
+
+static constexpr auto char_classes = [] {
+    auto result = std::array<CharClass, 256>{};
+    for (const auto c : u8" \t\n\v\f\r"sv) {
+        result[c] = CharClass::Whitespace;
+    }
+    for (const auto& [lexeme, token_type] : non_keyword_tokens) {
+        result[lexeme.front()] = CharClass::Punctuation;
+    }
+    result[u8'/'] = CharClass::Slash;
+    for (auto c = u8'0'; c <= u8'9'; ++c) {
+        result[c] = CharClass::Digit;
+    }
+    result[u8'\''] = CharClass::Quote;
+    for (auto c = u8'a'; c <= u8'z'; ++c) {
+        result[c] = CharClass::AsciiLetter;
+        result[c - u8'a' + u8'A'] = CharClass::AsciiLetter;
+    }
+    for (auto c = usize{ 0x80 }; c < result.size(); ++c) {
+        result[c] = CharClass::NonAscii;
+    }
+    return result;
+}();
+
+// all non-keyword tokens starting with a given byte
+struct PunctuationCandidates final {
+    std::array<std::pair<char8_t, TokenType>, 2> two_byte_tokens{};
+    usize num_two_byte_tokens{ 0 };
+    TokenType single_byte_token{};
+    bool has_single_byte_token{ false };
+};
+
+static constexpr auto punctuation_candidates = [] {
+    auto result = std::array<PunctuationCandidates, 256>{};
+    for (const auto& [lexeme, token_type] : non_keyword_tokens) {
+        assert(lexeme.length() == 1 or lexeme.length() == 2);
+        auto& candidates = result[lexeme.front()];
+        if (lexeme.length() == 1) {
+            candidates.single_byte_token = token_type;
+            candidates.has_single_byte_token = true;
+        } else {
+            assert(candidates.num_two_byte_tokens < candidates.two_byte_tokens.size());
+            candidates.two_byte_tokens[candidates.num_two_byte_tokens] = std::pair{ lexeme[1], token_type };
+            ++candidates.num_two_byte_tokens;
+        }
+    }
+    return result;
+}();
+
+[[nodiscard]] static constexpr bool is_binary_digit(const char8_t c) {
+    return c == u8'0' or c == u8'1';
+}
+
+[[nodiscard]] static constexpr bool is_octal_digit(const char8_t c) {
+    return c >= u8'0' and c <= u8'7';
+}
+
+[[nodiscard]] static constexpr bool is_decimal_digit(const char8_t c) {
+    return c >= u8'0' and c <= u8'9';
+}
+
+[[nodiscard]] static constexpr bool is_hexadecimal_digit(const char8_t c) {
+    return is_decimal_digit(c) or (c >= u8'a' and c <= u8'f') or (c >= u8'A' and c <= u8'F');
+}
+
+[[nodiscard]] static constexpr bool is_ascii_identifier_continuation(const char8_t c) {
+    return char_classes[c] == CharClass::AsciiLetter or is_decimal_digit(c) or c == u8'_';
+}
+
+// length of the longest prefix matching ([digit]+_?)+
+template<typename DigitPredicate>
+[[nodiscard]] static usize digits_with_separators_length(const std::u8string_view view, DigitPredicate is_digit) {
+    auto length = usize{ 0 };
+    while (length < view.length() and is_digit(view[length])) {
+        while (length < view.length() and is_digit(view[length])) {
+            ++length;
+        }
+        if (length < view.length() and view[length] == u8'_') {
+            ++length;
+        }
+    }
+    return length;
+}
+
 struct LexerState final {
 private:
-    std::string_view m_filename;
+    FileId m_file_id;
     std::u8string_view m_source_code;
     usize m_index{ 0 };
-    TokenVector tokens{};
+    usize m_valid_utf8_end{ 0 }; // all bytes between m_index and this offset are known to be valid UTF-8
+    TokenVector m_tokens{};
 
 public:
-    LexerState(const std::string_view filename, const std::u8string_view sourceCode)
-        : m_filename{ filename },
-          m_source_code{ sourceCode } { }
+    // starts lexing at the given offset, appending to the given tokens
+    explicit LexerState(const FileId file_id, const usize start = 0, TokenVector tokens = {})
+        : m_file_id{ file_id },
+          m_source_code{ SourceFiles::get(file_id).source_code() },
+          m_index{ start },
+          m_valid_utf8_end{ start },
+          m_tokens{ std::move(tokens) } { }
+
+    [[nodiscard]] usize index() const {
+        return m_index;
+    }
+
+    [[nodiscard]] TokenVector& tokens() {
+        return m_tokens;
+    }
 
     [[nodiscard]] char8_t current() const {
         return m_source_code.at(m_index);
@@ -133,30 +292,32 @@ public:
     }
 
 
-    [[nodiscard]] auto filename() const {
-        return m_filename;
+    [[nodiscard]] auto file_id() const {
+        return m_file_id;
     }
 
     [[nodiscard]] auto source_code() const {
         return m_source_code;
     }
 
+    [[nodiscard]] CharClass current_char_class() const {
+        return char_classes[current()];
+    }
+
     [[nodiscard]] auto source_location_from_bytes(const usize num_bytes = 1) const {
         assert(not is_end_of_file());
-        const auto lexeme = std::u8string_view{ &m_source_code.at(m_index), &m_source_code.at(m_index) + num_bytes };
-        return SourceLocation{ m_filename, m_source_code, lexeme };
+        return SourceLocation{ m_file_id, m_index, num_bytes };
     }
 
     [[nodiscard]] auto source_location_from_codepoints(const usize num_codepoints = 1) const {
         assert(not is_end_of_file());
         auto current_index = m_index;
         for (usize i = 0; i < num_codepoints; ++i) {
-            const auto remaining_source = m_source_code.substr(m_index);
+            const auto remaining_source = m_source_code.substr(current_index);
             const auto codepoint = utils::first_utf8_codepoint(remaining_source).value();
             current_index += codepoint.length();
         }
-        const auto lexeme = std::u8string_view{ &m_source_code.at(m_index), &m_source_code.at(current_index) };
-        return SourceLocation{ m_filename, m_source_code, lexeme };
+        return SourceLocation{ m_file_id, m_index, current_index - m_index };
     }
 
     [[nodiscard]] auto view_from_current() const {
@@ -164,161 +325,312 @@ public:
         return m_source_code.substr(m_index);
     }
 
-    [[nodiscard]] bool current_is_valid_codepoint() const {
-        const auto codepoint = utils::first_utf8_codepoint(view_from_current());
-        return codepoint.has_value();
+    // the source code is validated lazily, up to the next invalid codepoint
+    [[nodiscard]] bool current_is_valid_codepoint() {
+        if (m_index >= m_valid_utf8_end) {
+            m_valid_utf8_end = m_index + simd::valid_utf8_prefix_length(view_from_current());
+        }
+        return m_index < m_valid_utf8_end;
     }
 
     void push_token(const TokenType token_type, const usize num_lexeme_bytes = 1) {
-        tokens.emplace_back(source_location_from_bytes(num_lexeme_bytes), token_type);
+        m_tokens.emplace_back(source_location_from_bytes(num_lexeme_bytes), token_type);
         advance_bytes(num_lexeme_bytes);
     };
 
+    // only needed for tokens of unbounded length (integer literals)
+    [[nodiscard]] Result<bool, LexerError> try_push_token(const TokenType token_type, const usize num_lexeme_bytes) {
+        if (num_lexeme_bytes > Token::max_length) {
+            return Error<LexerError>{
+                LexerError{source_location_from_bytes(num_lexeme_bytes), ErrorCode::TokenTooLong}
+            };
+        }
+        push_token(token_type, num_lexeme_bytes);
+        return true;
+    }
+
+    [[nodiscard]] Result<bool, LexerError> try_push_identifier(const std::u8string_view identifier) {
+        if (identifier.length() > Token::max_length) {
+            return Error<LexerError>{
+                LexerError{source_location_from_bytes(identifier.length()), ErrorCode::TokenTooLong}
+            };
+        }
+        m_tokens.emplace_back(source_location_from_bytes(identifier.length()), StringInterner::intern(identifier));
+        advance_bytes(identifier.length());
+        return true;
+    }
+
+    // on the newline that has been added to the end of the source code
+    [[nodiscard]] Token end_of_file_token() const {
+        return Token{ SourceLocation{ file_id(), source_code().length() - 1, 1 }, TokenType::EndOfFile };
+    }
+
     [[nodiscard]] TokenVector&& tokens_moved() {
         // first add end of file token
-        tokens.emplace_back(
-                SourceLocation{ filename(), source_code(), source_code().substr(source_code().length() - 1) },
-                TokenType::EndOfFile
-        );
+        m_tokens.push_back(end_of_file_token());
 
-        return std::move(tokens);
+        return std::move(m_tokens);
     }
 
-    [[nodiscard]] bool try_consume_whitespace() {
-        if (std::isspace(static_cast<unsigned char>(current()))) {
-            advance_bytes();
-            return true;
-        }
-        return false;
+    void consume_whitespace() {
+        assert(current_char_class() == CharClass::Whitespace);
+        advance_bytes(simd::whitespace_prefix_length(view_from_current()));
     }
 
-    [[nodiscard]] bool try_consume_single_line_comment() {
-        if (const auto next = peek(); next and current() == '/' and *next == '/') {
-            advance_bytes(2);
-            while (not is_end_of_file() and current() != '\n') {
-                advance_bytes();
-            }
+    // a comment or a single forward slash
+    [[nodiscard]] Result<bool, LexerError> consume_slash() {
+        assert(current() == u8'/');
+        const auto next = peek();
+        if (next == u8'/') {
+            consume_single_line_comment();
             return true;
         }
-        return false;
+        if (next == u8'*') {
+            return consume_multiline_comment();
+        }
+        push_token(TokenType::ForwardSlash);
+        return true;
     }
 
-    [[nodiscard]] Result<bool, LexerError> try_consume_multiline_comment() {
-        if (auto next = peek(); next and current() == '/' and *next == '*') {
-            auto starting_source_location = source_location_from_bytes(2);
-            advance_bytes(2);
-            auto nesting_level = usize{ 1 };
+    void consume_single_line_comment() {
+        advance_bytes(2);
+        advance_bytes(simd::find_newline(m_source_code.substr(m_index)));
+    }
 
-            while (not is_end_of_file()) {
-                if (next = peek(); next and current() == '/' and *next == '*') {
-                    advance_bytes(2);
-                    ++nesting_level;
-                    continue;
-                }
+    [[nodiscard]] Result<bool, LexerError> consume_multiline_comment() {
+        const auto starting_source_location = source_location_from_bytes(2);
+        advance_bytes(2);
+        auto nesting_level = usize{ 1 };
 
-                if (next = peek(); next and current() == '*' and *next == '/') {
-                    advance_bytes(2);
-                    --nesting_level;
-                    if (nesting_level == 0) {
-                        break;
-                    }
-                    continue;
-                }
+        while (not is_end_of_file()) {
+            advance_bytes(simd::find_comment_delimiter(view_from_current()));
+            if (is_end_of_file()) {
+                break;
+            }
 
-                advance_bytes();
+            if (const auto next = peek(); next and current() == '/' and *next == '*') {
+                advance_bytes(2);
+                ++nesting_level;
+                continue;
             }
-            if (is_end_of_file()) {
-                return Error<LexerError>{
-                    LexerError{starting_source_location, ErrorCode::UnterminatedComment}
-                };
+
+            if (const auto next = peek(); next and current() == '*' and *next == '/') {
+                advance_bytes(2);
+                --nesting_level;
+                if (nesting_level == 0) {
+                    return true;
+                }
+                continue;
             }
-            return true;
+
+            advance_bytes();
         }
-        return false;
+        return Error<LexerError>{
+            LexerError{starting_source_location, ErrorCode::UnterminatedComment}
+        };
     }
 
-    [[nodiscard]] bool try_consume_non_keyword_token() {
-        const auto non_keyword_iterator = ranges::find_if(non_keyword_tokens, [&](const auto& pair) {
-            const auto& lexeme = pair.first;
-            return view_from_current().starts_with(lexeme);
-        });
-        const auto found_non_keyword_token = (non_keyword_iterator != non_keyword_tokens.cend());
-        if (found_non_keyword_token) {
-            const auto& [lexeme, token_type] = *non_keyword_iterator;
-            push_token(token_type, lexeme.length());
+    [[nodiscard]] bool try_consume_punctuation() {
+        const auto& candidates = punctuation_candidates[current()];
+        if (const auto next = peek()) {
+            for (usize i = 0; i < candidates.num_two_byte_tokens; ++i) {
+                const auto& [second_byte, token_type] = candidates.two_byte_tokens[i];
+                if (*next == second_byte) {
+                    push_token(token_type, 2);
+                    return true;
+                }
+            }
+        }
+        if (candidates.has_single_byte_token) {
+            push_token(candidates.single_byte_token);
             return true;
         }
         return false;
     }
 
+    // matches '(\\'|[ -\[\]-~]|\\[n\\tnvfr0])'
     [[nodiscard]] bool try_consume_char_literal() {
-        if (const auto char_literal_result = ctre::starts_with<char_pattern>(view_from_current())) {
-            const auto length = char_literal_result.view().length();
-            push_token(TokenType::CharLiteral, length);
+        assert(current() == u8'\'');
+        const auto view = view_from_current();
+        if (view.length() >= 4 and view[1] == u8'\\' and u8"'n\\tvfr0"sv.find(view[2]) != std::u8string_view::npos
+            and view[3] == u8'\'') {
+            push_token(TokenType::CharLiteral, 4);
+            return true;
+        }
+        if (view.length() >= 3 and view[1] >= u8' ' and view[1] <= u8'~' and view[1] != u8'\\' and view[2] == u8'\'') {
+            push_token(TokenType::CharLiteral, 3);
             return true;
         }
         return false;
     }
 
-    [[nodiscard]] bool try_consume_integer_literal() {
-        if (const auto integer_literal_result = ctre::starts_with<integer_pattern>(view_from_current())) {
-            const auto length = integer_literal_result.view().length();
-            push_token(TokenType::U32Literal, length);
-            return true;
+    // matches (0o([0-7]+_?)+)|(0x([\dA-Fa-f]+_?)+)|(0b([01]+_?)+)|(\d+_?)+
+    [[nodiscard]] Result<bool, LexerError> consume_integer_literal() {
+        assert(current_char_class() == CharClass::Digit);
+        const auto view = view_from_current();
+        if (view.length() >= 2 and view[0] == u8'0') {
+            const auto digits = view.substr(2);
+            auto num_digits = usize{ 0 };
+            switch (view[1]) {
+                case u8'o':
+                    num_digits = digits_with_separators_length(digits, is_octal_digit);
+                    break;
+                case u8'x':
+                    num_digits = digits_with_separators_length(digits, is_hexadecimal_digit);
+                    break;
+                case u8'b':
+                    num_digits = digits_with_separators_length(digits, is_binary_digit);
+                    break;
+                default:
+                    break;
+            }
+            if (num_digits > 0) {
+                return try_push_token(TokenType::U32Literal, num_digits + 2);
+            }
         }
-        return false;
+        return try_push_token(TokenType::U32Literal, digits_with_separators_length(view, is_decimal_digit));
+    }
+
+    [[nodiscard]] Result<bool, LexerError> consume_ascii_identifier_or_keyword() {
+        assert(current_char_class() == CharClass::AsciiLetter);
+        const auto view = view_from_current();
+        auto length = usize{ 1 };
+        while (length < view.length() and is_ascii_identifier_continuation(view[length])) {
+            ++length;
+        }
+        if (length < view.length() and char_classes[view[length]] == CharClass::NonAscii) {
+            // the identifier may continue with non-ASCII characters
+            return try_consume_identifier_or_keyword();
+        }
+        return push_identifier_or_keyword(view.substr(0, length));
     }
 
-    [[nodiscard]] bool try_consume_identifier_or_keyword() {
+    [[nodiscard]] Result<bool, LexerError> try_consume_identifier_or_keyword() {
         if (const auto identifier_result = ctre::starts_with<identifier_pattern>(view_from_current())) {
-            const auto keyword_iterator =
-                    ranges::find_if(keywords, [&](const auto& pair) { return pair.first == identifier_result.view(); });
-            const auto is_keyword = (keyword_iterator != keywords.cend());
-            if (is_keyword) {
-                const auto& [lexeme, token_type] = *keyword_iterator;
-                push_token(token_type, lexeme.length());
-            } else {
-                const auto length = identifier_result.view().length();
-                push_token(TokenType::Identifier, length);
-            }
-            return true;
+            return push_identifier_or_keyword(identifier_result.view());
         }
         return false;
     }
+
+    [[nodiscard]] Result<bool, LexerError> push_identifier_or_keyword(const std::u8string_view identifier) {
+        if (const auto keyword = find_keyword(identifier)) {
+            push_token(*keyword, identifier.length());
+            return true;
+        }
+        return try_push_identifier(identifier);
+    }
 };
 
 
-[[nodiscard]] Result<TokenVector, LexerError>
-tokenize(const std::string_view filename, const std::u8string_view source_code) {
-    assert(not source_code.empty() and source_code.back() == '\n');
+// consumes the whitespace, the comment or the token at the current position
+[[nodiscard]] static Optional<LexerError> consume_next(LexerState& state) {
+    auto result = Result<bool, LexerError>{ false };
 
-    auto state = LexerState{ filename, source_code };
+    switch (state.current_char_class()) {
+        case CharClass::Whitespace:
+            state.consume_whitespace();
+            return {};
+        case CharClass::Slash:
+            result = state.consume_slash();
+            break;
+        case CharClass::Punctuation:
+            result = state.try_consume_punctuation();
+            break;
+        case CharClass::Digit:
+            result = state.consume_integer_literal();
+            break;
+        case CharClass::Quote:
+            result = state.try_consume_char_literal();
+            break;
+        case CharClass::AsciiLetter:
+            result = state.consume_ascii_identifier_or_keyword();
+            break;
+        case CharClass::NonAscii:
+            // only non-ASCII characters can form invalid codepoints
+            if (not state.current_is_valid_codepoint()) {
+                return LexerError{ state.source_location_from_bytes(), ErrorCode::InvalidInput };
+            }
+            result = state.try_consume_identifier_or_keyword();
+            break;
+        case CharClass::Invalid:
+            break;
+    }
 
-    while (not state.is_end_of_file()) {
-        if (not state.current_is_valid_codepoint()) {
-            return Error<LexerError>{
-                LexerError{state.source_location_from_bytes(), ErrorCode::InvalidInput}
-            };
-        }
+    if (not result.has_value()) {
+        return result.error();
+    }
+    if (not *result) {
+        return LexerError{ state.source_location_from_codepoints(), ErrorCode::InvalidInput };
+    }
+    return {};
+}
 
-        if (state.try_consume_whitespace() or state.try_consume_single_line_comment()
-            or state.try_consume_non_keyword_token() or state.try_consume_char_literal()
-            or state.try_consume_integer_literal() or state.try_consume_identifier_or_keyword()) {
-            continue;
-        }
+TokenStream::TokenStream(const FileId file_id) : TokenStream{ file_id, 0 } { }
 
-        const auto multiline_comment_result = state.try_consume_multiline_comment();
-        if (not multiline_comment_result.has_value()) {
-            return Error<LexerError>{ multiline_comment_result.error() };
-        }
-        if (*multiline_comment_result) {
-            continue;
-        }
+TokenStream::TokenStream(const FileId file_id, const usize offset)
+    : m_state{ std::make_unique<LexerState>(file_id, offset) } {
+    assert(not m_state->source_code().empty() and m_state->source_code().back() == '\n');
+    assert(offset < m_state->source_code().length());
+}
 
-        return Error<LexerError>{
-            LexerError{state.source_location_from_codepoints(), ErrorCode::InvalidInput}
-        };
+TokenStream::TokenStream(TokenStream&&) noexcept = default;
+
+TokenStream& TokenStream::operator=(TokenStream&&) noexcept = default;
+
+TokenStream::~TokenStream() = default;
+
+[[nodiscard]] Token TokenStream::at(const usize index) {
+    assert(index >= m_begin and "the token has already been released");
+    while (index >= m_begin + m_tokens.size() and not m_end_of_file) {
+        lex_next();
+    }
+    if (index >= m_begin + m_tokens.size()) {
+        return *m_end_of_file;
+    }
+    return m_tokens[index - m_begin];
+}
+
+[[nodiscard]] Token TokenStream::buffered(const usize index) const {
+    assert(index >= m_begin and index < m_begin + m_tokens.size() and "the token is not buffered");
+    return m_tokens[index - m_begin];
+}
+
+void TokenStream::release(const usize index) {
+    while (m_begin < index and not m_tokens.empty()) {
+        m_tokens.pop_front();
+        ++m_begin;
     }
+}
+
+// consumes source code until at least one token has been produced (or the end of the file has been reached)
+void TokenStream::lex_next() {
+    if (m_state->is_end_of_file()) {
+        m_end_of_file = m_state->end_of_file_token();
+        m_tokens.push_back(*m_end_of_file);
+    } else if (const auto error = consume_next(*m_state)) {
+        // the parser still comes to an end, but its result is discarded
+        m_error = *error;
+        m_end_of_file = m_state->end_of_file_token();
+        m_tokens.push_back(*m_end_of_file);
+    } else {
+        auto& tokens = m_state->tokens();
+        m_tokens.insert(m_tokens.end(), tokens.begin(), tokens.end());
+        m_num_tokens += tokens.size();
+        tokens.clear();
+    }
+    m_max_num_buffered = std::max(m_max_num_buffered, m_tokens.size());
+}
+
+[[nodiscard]] Result<TokenVector, LexerError> TokenStream::collect() && {
+    assert(m_begin == 0 and m_tokens.empty() and not m_end_of_file and "tokens have already been read");
+    while (not m_state->is_end_of_file()) {
+        if (const auto error = consume_next(*m_state)) {
+            return Error<LexerError>{ *error };
+        }
+    }
+    return m_state->tokens_moved();
+}
 
-    return state.tokens_moved();
+[[nodiscard]] Result<TokenVector, LexerError> tokenize(const FileId file_id) {
+    return TokenStream{ file_id }.collect();
 }
@@ -1,8 +1,12 @@
 #pragma once
 
 #include "error_codes.hpp"
+#include "source_files.hpp"
 #include "tokens.hpp"
 #include "types.hpp"
+#include <deque>
+#include <memory>
+#include <vector>
 
 using TokenVector = std::vector<Token>;
 
@@ -11,4 +15,67 @@ struct LexerError final {
     ErrorCode error_code;
 };
 
-[[nodiscard]] Result<TokenVector, LexerError> tokenize(std::string_view filename, std::u8string_view source_code);
+// Replaces the bytes [offset, offset + length) of the source code of a file by replacement_length other bytes. The
+// offsets never include the newline that is added to the end of every source file.
+struct TextEdit final {
+    usize offset;
+    usize length;
+    usize replacement_length;
+};
+
+struct LexerState;
+
+// Lexes a file on demand, only as far as the tokens that have been asked for. The tokens are buffered until they are
+// released, so a consumer that releases the tokens it is done with (like the parser) only keeps a bounded number of
+// them in memory. After a lexer error, the stream ends with an end of file token and the error is kept.
+struct TokenStream final {
+private:
+    std::unique_ptr<LexerState> m_state;
+    // the tokens [m_begin, m_begin + m_tokens.size()) have been produced, but not released yet
+    std::deque<Token> m_tokens;
+    usize m_begin{ 0 };
+    usize m_num_tokens{ 0 };
+    usize m_max_num_buffered{ 0 };
+    Optional<Token> m_end_of_file;
+    Optional<LexerError> m_error;
+
+    void lex_next();
+
+public:
+    explicit TokenStream(FileId file_id);
+    // Starts lexing at the given offset, which has to be the start of the file or the start or end of a token. Between
+    // tokens, the lexer does not carry any state (in particular, it is never within a comment), so the tokens from
+    // there on are the same as if the whole file had been lexed. Indices start at the first token behind the offset.
+    TokenStream(FileId file_id, usize offset);
+    TokenStream(TokenStream&&) noexcept;
+    TokenStream& operator=(TokenStream&&) noexcept;
+    ~TokenStream();
+
+    // indices behind the end of file token refer to the end of file token, released tokens cannot be accessed
+    [[nodiscard]] Token at(usize index);
+
+    // the tokens in front of the given index are not accessed anymore
+    void release(usize index);
+
+    // a token that has been produced but not released yet, several threads may read the buffered tokens at once
+    [[nodiscard]] Token buffered(usize index) const;
+
+    [[nodiscard]] const Optional<LexerError>& error() const {
+        return m_error;
+    }
+
+    // without the end of file token
+    [[nodiscard]] usize num_tokens() const {
+        return m_num_tokens;
+    }
+
+    [[nodiscard]] usize max_num_buffered() const {
+        return m_max_num_buffered;
+    }
+
+    // all tokens at once, which is only possible before any token has been read
+    [[nodiscard]] Result<TokenVector, LexerError> collect() &&;
+};
+
+// all tokens at once, without a buffer in between
+[[nodiscard]] Result<TokenVector, LexerError> tokenize(FileId file_id);
@@ -0,0 +1,80 @@
+#include "line_table.hpp"
+#include "simd.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <utility>
+
+[[nodiscard]] static bool is_printable_ascii(const char8_t c) {
+    return c >= 0x20 and c < 0x7F;
+}
+
+LineTable::LineTable(const std::u8string_view source_code) : m_source_code{ source_code } {
+    assert(source_code.length() <= std::numeric_limits<u32>::max());
+
+    m_line_starts.push_back(0);
+    auto kind = LineKind::PrintableAscii;
+    for (usize i = 0; i < source_code.length(); ++i) {
+        const auto c = source_code[i];
+        if (c == '\n') {
+            m_line_kinds.push_back(kind);
+            m_line_starts.push_back(static_cast<u32>(i + 1));
+            kind = LineKind::PrintableAscii;
+        } else if (c >= 0x80) {
+            kind = LineKind::Unicode;
+        } else if (kind == LineKind::PrintableAscii and not is_printable_ascii(c)) {
+            kind = LineKind::Ascii;
+        }
+    }
+    m_line_kinds.push_back(kind);
+}
+
+[[nodiscard]] usize LineTable::line_number(const usize offset) const {
+    assert(offset <= m_source_code.length());
+    // the number of lines starting at or before the offset is the (1-based) line number
+    const auto next_line_start = std::ranges::upper_bound(m_line_starts, offset);
+    return static_cast<usize>(next_line_start - m_line_starts.cbegin());
+}
+
+[[nodiscard]] usize LineTable::column_number(const usize offset) const {
+    const auto line_index = line_number(offset) - 1;
+    const auto line_start = usize{ m_line_starts[line_index] };
+    return width(m_line_kinds[line_index], m_source_code.substr(line_start, offset - line_start)) + 1;
+}
+
+[[nodiscard]] std::vector<usize> LineTable::column_numbers(const std::span<const usize> offsets) const {
+    auto result = std::vector<usize>{};
+    result.reserve(offsets.size());
+    auto line_index = usize{ 0 };
+    auto next_line_start = usize{ 0 };
+    auto previous_offset = usize{ 0 };
+    auto column = usize{ 1 };
+    for (const auto offset : offsets) {
+        assert(offset >= previous_offset and offset <= m_source_code.length());
+        if (offset >= next_line_start) {
+            line_index = line_number(offset) - 1;
+            next_line_start = (line_index + 1 < m_line_starts.size() ? usize{ m_line_starts[line_index + 1] }
+                                                                     : m_source_code.length() + 1);
+            previous_offset = m_line_starts[line_index];
+            column = 1;
+        }
+        // only the part of the line since the previous offset has to be measured
+        column += width(m_line_kinds[line_index], m_source_code.substr(previous_offset, offset - previous_offset));
+        previous_offset = offset;
+        result.push_back(column);
+    }
+    return result;
+}
+
+[[nodiscard]] usize LineTable::width(const LineKind kind, const std::u8string_view text) {
+    switch (kind) {
+        case LineKind::PrintableAscii:
+            return text.length();
+        case LineKind::Ascii:
+            return simd::printable_ascii_count(text);
+        case LineKind::Unicode:
+            return utils::utf8_width(text).value();
+    }
+    std::unreachable();
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "types.hpp"
+#include <span>
+#include <string_view>
+#include <vector>
+
+// Maps byte offsets into a source file to line and column numbers. The table is built once per
+// file and answers lookups with a binary search over the line starts instead of rescanning the file.
+struct LineTable final {
+private:
+    enum class LineKind : u8 {
+        PrintableAscii, // every byte has a display width of 1
+        Ascii,          // contains control characters (e.g. tabs) that have a display width of 0
+        Unicode,        // contains multibyte codepoints
+    };
+
+    std::u8string_view m_source_code;
+    std::vector<u32> m_line_starts;
+    std::vector<LineKind> m_line_kinds;
+
+public:
+    explicit LineTable(std::u8string_view source_code);
+
+    [[nodiscard]] auto source_code() const {
+        return m_source_code;
+    }
+
+    [[nodiscard]] usize num_lines() const {
+        return m_line_starts.size();
+    }
+
+    [[nodiscard]] usize line_number(usize offset) const;
+    [[nodiscard]] usize column_number(usize offset) const;
+
+    // the column numbers of the given (ascending) offsets, every line is only scanned once no matter how many of
+    // the offsets are on it
+    [[nodiscard]] std::vector<usize> column_numbers(std::span<const usize> offsets) const;
+
+private:
+    [[nodiscard]] static usize width(LineKind kind, std::u8string_view text);
+};
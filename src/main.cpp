@@ -1,42 +1,43 @@
-#include "lexer.hpp"
-#include "parser.hpp"
-#include "utils.hpp"
-#include <filesystem>
+#include "compile_server.hpp"
+#include "driver.hpp"
+#include "language_server.hpp"
+#include "thread_pool.hpp"
+#include <cstdlib>
 #include <fmt/format.h>
 #include <magic_enum.hpp>
+#include <string>
+#include <vector>
 
+[[nodiscard]] static int print_result(const DriverResult& result) {
+    fmt::print("{}", result.output);
+    fmt::print(stderr, "{}", result.diagnostics);
+    return result.exit_code;
+}
+
+[[nodiscard]] static int print_error(const ServerError error) {
+    fmt::print(stderr, "{}\n", magic_enum::enum_name(error));
+    return EXIT_FAILURE;
+}
+
+// usage: Seatbelt2 [options] <input files...> (see --help)
+int main(const int argc, const char* const* const argv) {
+    const auto arguments = std::vector<std::string>(argv + 1, argv + argc);
+    const auto options = parse_command_line(arguments);
+    if (not options) {
+        return print_result(options.error());
+    }
 
-int main() {
-    const auto filename = std::string{ "test.bs" };
-    const auto source_code = utils::read_text_file(filename).value();
-    auto tokens = tokenize(filename, source_code);
-    if (tokens.has_value()) {
-        for (const auto& token : *tokens) {
-            fmt::print(
-                    stderr, "{}:{}:{}: {} (\"{}\")\n", token.location.filename(), token.location.line_number(),
-                    token.location.column_number(), magic_enum::enum_name(token.type),
-                    utils::to_string_view(token.location.lexeme())
-            );
-        }
-        const auto program = parse(std::move(*tokens));
-        if (program.has_value()) {
-            fmt::print(stderr, "{}", program->to_string());
-        } else {
-            fmt::print(stderr, "parser error:\n");
-            for (const auto& error : program.error()) {
-                fmt::print(
-                        stderr, "{}:{}:{}: {} (\"{}\")\n", error.location.filename(), error.location.line_number(),
-                        error.location.column_number(), magic_enum::enum_name(error.error_code),
-                        utils::to_string_view(error.location.lexeme())
-                );
-            }
-        }
-    } else {
-        fmt::print(
-                stderr, "{}:{}:{}: {} (\"{}\")", tokens.error().location.filename(),
-                tokens.error().location.line_number(), tokens.error().location.column_number(),
-                magic_enum::enum_name(tokens.error().error_code),
-                utils::to_string_view(tokens.error().location.lexeme())
-        );
+    if (options->server_socket) {
+        return print_error(run_server(*options->server_socket, options->num_jobs));
+    }
+    if (options->language_server) {
+        return run_language_server(stdin, stdout, options->time_report);
     }
+    if (options->client_socket) {
+        const auto result = run_client(*options->client_socket, arguments);
+        return result ? print_result(*result) : print_error(result.error());
+    }
+
+    auto pool = ThreadPool{ options->num_jobs };
+    return print_result(run_driver(*options, pool));
 }
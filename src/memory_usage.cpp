@@ -0,0 +1,65 @@
+#include "memory_usage.hpp"
+
+#if defined(__linux__)
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+// the current and the peak resident set size are listed in kilobytes
+[[nodiscard]] static Optional<usize> process_status_bytes(const std::string_view key) {
+    auto status = std::ifstream{ "/proc/self/status" };
+    auto line = std::string{};
+    while (std::getline(status, line)) {
+        if (line.starts_with(key)) {
+            auto kilobytes = usize{ 0 };
+            std::istringstream{ line.substr(key.length()) } >> kilobytes;
+            return kilobytes * 1024;
+        }
+    }
+    return {};
+}
+
+[[nodiscard]] Optional<usize> current_rss() {
+    return process_status_bytes("VmRSS:");
+}
+
+[[nodiscard]] Optional<usize> peak_rss() {
+    return process_status_bytes("VmHWM:");
+}
+
+void reset_peak_rss() {
+    auto clear_refs = std::ofstream{ "/proc/self/clear_refs" };
+    clear_refs << "5";
+}
+#elif defined(__unix__) or defined(__APPLE__)
+#include <sys/resource.h>
+
+[[nodiscard]] Optional<usize> current_rss() {
+    return {};
+}
+
+[[nodiscard]] Optional<usize> peak_rss() {
+    auto usage = rusage{};
+    if (::getrusage(RUSAGE_SELF, &usage) != 0) {
+        return {};
+    }
+#if defined(__APPLE__)
+    return static_cast<usize>(usage.ru_maxrss);
+#else
+    return static_cast<usize>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+void reset_peak_rss() { }
+#else
+[[nodiscard]] Optional<usize> current_rss() {
+    return {};
+}
+
+[[nodiscard]] Optional<usize> peak_rss() {
+    return {};
+}
+
+void reset_peak_rss() { }
+#endif
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "types.hpp"
+
+// Resident set size of the process in bytes, nothing where it cannot be determined. Resetting the peak is only
+// supported on Linux, elsewhere the peak always covers the whole lifetime of the process.
+[[nodiscard]] Optional<usize> current_rss();
+[[nodiscard]] Optional<usize> peak_rss();
+void reset_peak_rss();
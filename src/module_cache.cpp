@@ -0,0 +1,449 @@
+#include "module_cache.hpp"
+#include "hash.hpp"
+#include "version.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fmt/format.h>
+#include <fstream>
+#include <magic_enum.hpp>
+#include <random>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+using namespace parser_nodes;
+
+// has to be incremented whenever the layout of the entries or of the syntax tree changes
+static constexpr auto format_version = u32{ 1 };
+static constexpr auto magic = u32{ 0x4342'5353 }; // "SSBC"
+static constexpr auto no_token = u32{ 0xFFFF'FFFF };
+static constexpr auto entry_file_extension = std::string_view{ ".bsc" };
+
+// An entry starts with this header, followed by the tokens (two words each: the offset and the length and type)
+// and by the syntax tree, which is a sequence of words that refer to the tokens by their index.
+struct EntryHeader final {
+    u32 magic;
+    u32 format_version;
+    u64 key;
+    u64 source_length;
+    u32 num_tokens;
+    u32 num_words;
+};
+
+static_assert(std::is_trivially_copyable_v<EntryHeader> and sizeof(EntryHeader) == 32);
+
+enum class StatementKind : u32 {
+    FunctionDefinition,
+};
+
+[[nodiscard]] static u64 cache_key(const std::u8string_view source_code) {
+    static const auto seed = hash_bytes(std::as_bytes(std::span{ compiler_version })) ^ format_version;
+    return hash_bytes(std::as_bytes(std::span{ source_code }), seed);
+}
+
+template<typename T>
+static void append(std::vector<std::byte>& bytes, const T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    const auto value_bytes = std::as_bytes(std::span{ &value, 1 });
+    bytes.insert(bytes.end(), value_bytes.begin(), value_bytes.end());
+}
+
+struct EntryWriter final {
+private:
+    std::span<const Token> m_tokens;
+    std::vector<u32> m_words;
+    bool m_failed{ false };
+
+public:
+    explicit EntryWriter(const std::span<const Token> tokens) : m_tokens{ tokens } { }
+
+    [[nodiscard]] bool failed() const {
+        return m_failed;
+    }
+
+    [[nodiscard]] std::span<const u32> words() const {
+        return m_words;
+    }
+
+    void write(const u32 word) {
+        m_words.push_back(word);
+    }
+
+    void write_count(const usize count) {
+        write(static_cast<u32>(count));
+    }
+
+    // the tokens are sorted by their offsets
+    void write(const Token token) {
+        const auto iterator = std::ranges::lower_bound(m_tokens, token.offset(), {}, &Token::offset);
+        if (iterator == m_tokens.end() or iterator->offset() != token.offset() or iterator->type() != token.type()) {
+            m_failed = true;
+            return;
+        }
+        write(static_cast<u32>(iterator - m_tokens.begin()));
+    }
+
+    void write(const Optional<Token> token) {
+        if (token) {
+            write(*token);
+        } else {
+            write(no_token);
+        }
+    }
+
+    void write(const Name& name) {
+        write_count(name.tokens.size());
+        for (const auto token : name.tokens) {
+            write(token);
+        }
+    }
+
+    void write(const Optional<TypeParameterList>& type_parameters) {
+        write(static_cast<u32>(type_parameters.has_value()));
+        if (not type_parameters) {
+            return;
+        }
+        write(type_parameters->left_curly_brace);
+        write_count(type_parameters->identifiers.size());
+        for (const auto identifier : type_parameters->identifiers) {
+            write(identifier);
+        }
+        write(type_parameters->right_curly_brace);
+    }
+
+    void write(const ParameterList& parameters) {
+        write(parameters.left_parenthesis);
+        write_count(parameters.parameters.size());
+        for (const auto& parameter : parameters.parameters) {
+            write(parameter.identifier);
+            write(parameter.type);
+        }
+        write(parameters.right_parenthesis);
+    }
+
+    void write(const Optional<ReturnType>& return_type) {
+        write(static_cast<u32>(return_type.has_value()));
+        if (return_type) {
+            write(return_type->tilde_arrow);
+            write(return_type->type);
+        }
+    }
+
+    void write(std::span<const Statement* const> statements) {
+        write_count(statements.size());
+        for (const auto statement : statements) {
+            write(*statement);
+        }
+    }
+
+    void write(const Block& block) {
+        write(block.left_curly_brace);
+        write(block.statements);
+        write(block.right_curly_brace);
+    }
+
+    void write(const Statement& statement) {
+        const auto function_definition = dynamic_cast<const FunctionDefinition*>(&statement);
+        if (function_definition == nullptr) {
+            m_failed = true;
+            return;
+        }
+        write(std::to_underlying(StatementKind::FunctionDefinition));
+        write(function_definition->export_token);
+        write(function_definition->function_keyword);
+        write(function_definition->identifier);
+        write(function_definition->type_parameters);
+        write(function_definition->parameters);
+        write(function_definition->return_type);
+        write(function_definition->body);
+    }
+
+    void write(const Program& program) {
+        write_count(program.imports.size());
+        for (const auto& import : program.imports) {
+            write(import.import_token);
+            write(import.module_name);
+            write(import.semicolon_token);
+        }
+        write(program.statements);
+    }
+};
+
+// Entries may be truncated or come from another machine, so everything that is read is validated. Like in the
+// parser, reading fails by setting a flag and returning placeholders, the result is discarded at the end.
+struct EntryReader final {
+private:
+    FileId m_file_id;
+    std::span<const std::byte> m_bytes;
+    usize m_position{ 0 };
+    bool m_failed{ false };
+    std::vector<Token> m_tokens;
+    std::unique_ptr<Arena> m_arena{ std::make_unique<Arena>() };
+
+public:
+    EntryReader(const FileId file_id, const std::span<const std::byte> bytes)
+        : m_file_id{ file_id },
+          m_bytes{ bytes } { }
+
+    [[nodiscard]] Optional<Program> program(const u64 key, const std::u8string_view source_code) {
+        const auto header = read<EntryHeader>();
+        if (m_failed or header.magic != magic or header.format_version != format_version or header.key != key
+            or header.source_length != source_code.length() or header.num_tokens == 0
+            or header.num_tokens > remaining_words() / 2) {
+            return {};
+        }
+
+        m_tokens.reserve(header.num_tokens);
+        for (usize i = 0; i < header.num_tokens; ++i) {
+            const auto offset = usize{ read<u32>() };
+            const auto length_and_type = read<u32>();
+            const auto length = usize{ length_and_type >> 8 };
+            const auto type = magic_enum::enum_cast<TokenType>(static_cast<u8>(length_and_type & 0xFF));
+            if (not type or length > Token::max_length or offset + length > source_code.length()) {
+                return {};
+            }
+            // symbols are only valid within the process that interned them
+            const auto location = SourceLocation{ m_file_id, offset, length };
+            if (*type == TokenType::Identifier) {
+                m_tokens.emplace_back(location, StringInterner::intern(source_code.substr(offset, length)));
+            } else {
+                m_tokens.emplace_back(location, *type);
+            }
+        }
+        if (header.num_words != remaining_words() or m_bytes.size() % sizeof(u32) != 0) {
+            return {};
+        }
+
+        const auto imports = this->imports();
+        const auto statements = this->statements();
+        if (m_failed or m_position != m_bytes.size()) {
+            return {};
+        }
+        return Program{ std::move(m_arena), imports, statements };
+    }
+
+private:
+    [[nodiscard]] usize remaining_words() const {
+        return (m_bytes.size() - m_position) / sizeof(u32);
+    }
+
+    template<typename T>
+    [[nodiscard]] T read() {
+        auto result = T{};
+        if (m_bytes.size() - m_position < sizeof(T)) {
+            m_failed = true;
+            return result;
+        }
+        std::memcpy(&result, m_bytes.data() + m_position, sizeof(T));
+        m_position += sizeof(T);
+        return result;
+    }
+
+    // every element takes at least one word, so larger counts can only come from a corrupted entry
+    [[nodiscard]] usize count() {
+        const auto result = usize{ read<u32>() };
+        if (result > remaining_words()) {
+            m_failed = true;
+            return 0;
+        }
+        return result;
+    }
+
+    [[nodiscard]] bool flag() {
+        const auto result = read<u32>();
+        if (result > 1) {
+            m_failed = true;
+        }
+        return result == 1;
+    }
+
+    [[nodiscard]] Token token() {
+        const auto index = read<u32>();
+        if (index >= m_tokens.size()) {
+            m_failed = true;
+            return m_tokens.front();
+        }
+        return m_tokens[index];
+    }
+
+    [[nodiscard]] Optional<Token> optional_token() {
+        const auto index = read<u32>();
+        if (index == no_token) {
+            return {};
+        }
+        if (index >= m_tokens.size()) {
+            m_failed = true;
+            return {};
+        }
+        return m_tokens[index];
+    }
+
+    [[nodiscard]] std::span<const Token> tokens() {
+        auto result = std::vector<Token>{};
+        const auto num_tokens = count();
+        result.reserve(num_tokens);
+        for (usize i = 0; i < num_tokens; ++i) {
+            result.push_back(token());
+        }
+        return m_arena->copy(std::span<const Token>{ result });
+    }
+
+    [[nodiscard]] Name name() {
+        return Name{ tokens() };
+    }
+
+    [[nodiscard]] Optional<TypeParameterList> type_parameter_list() {
+        if (not flag()) {
+            return {};
+        }
+        const auto left_curly_brace = token();
+        const auto identifiers = tokens();
+        const auto right_curly_brace = token();
+        return TypeParameterList{ left_curly_brace, identifiers, right_curly_brace };
+    }
+
+    [[nodiscard]] ParameterList parameter_list() {
+        const auto left_parenthesis = token();
+        auto parameters = std::vector<Parameter>{};
+        const auto num_parameters = count();
+        parameters.reserve(num_parameters);
+        for (usize i = 0; i < num_parameters; ++i) {
+            const auto identifier = token();
+            parameters.emplace_back(identifier, name());
+        }
+        const auto right_parenthesis = token();
+        return ParameterList{ left_parenthesis, m_arena->copy(std::span<const Parameter>{ parameters }),
+                              right_parenthesis };
+    }
+
+    [[nodiscard]] Optional<ReturnType> return_type() {
+        if (not flag()) {
+            return {};
+        }
+        const auto tilde_arrow = token();
+        return ReturnType{ tilde_arrow, name() };
+    }
+
+    [[nodiscard]] Block block() {
+        const auto left_curly_brace = token();
+        const auto statements = this->statements();
+        const auto right_curly_brace = token();
+        return Block{ left_curly_brace, statements, right_curly_brace };
+    }
+
+    [[nodiscard]] const Statement* statement() {
+        if (read<u32>() != std::to_underlying(StatementKind::FunctionDefinition)) {
+            m_failed = true;
+            return nullptr;
+        }
+        const auto export_token = optional_token();
+        const auto function_keyword = token();
+        const auto identifier = token();
+        auto type_parameters = type_parameter_list();
+        auto parameters = parameter_list();
+        auto return_type = this->return_type();
+        auto body = block();
+        return m_arena->create<FunctionDefinition>(
+                export_token, function_keyword, identifier, std::move(type_parameters), std::move(parameters),
+                std::move(return_type), std::move(body)
+        );
+    }
+
+    [[nodiscard]] std::span<const Statement* const> statements() {
+        auto result = std::vector<const Statement*>{};
+        const auto num_statements = count();
+        result.reserve(num_statements);
+        for (usize i = 0; i < num_statements and not m_failed; ++i) {
+            result.push_back(statement());
+        }
+        return m_arena->copy(std::span<const Statement* const>{ result });
+    }
+
+    [[nodiscard]] std::span<const ImportStatement> imports() {
+        auto result = std::vector<ImportStatement>{};
+        const auto num_imports = count();
+        result.reserve(num_imports);
+        for (usize i = 0; i < num_imports; ++i) {
+            const auto import_token = token();
+            auto module_name = name();
+            const auto semicolon_token = token();
+            result.emplace_back(import_token, std::move(module_name), semicolon_token);
+        }
+        return m_arena->copy(std::span<const ImportStatement>{ result });
+    }
+};
+
+ModuleCache::ModuleCache(std::filesystem::path directory) : m_directory{ std::move(directory) } {
+    // if the directory cannot be created, storing entries fails later on and nothing is cached
+    auto error = std::error_code{};
+    std::filesystem::create_directories(m_directory, error);
+}
+
+[[nodiscard]] std::filesystem::path ModuleCache::entry_path(const u64 key) const {
+    return m_directory / fmt::format("{:016x}{}", key, entry_file_extension);
+}
+
+[[nodiscard]] Optional<Program> ModuleCache::load(const FileId file_id) const {
+    const auto source_code = SourceFiles::get(file_id).source_code();
+    const auto key = cache_key(source_code);
+    const auto entry = SourceBuffer::from_file(entry_path(key));
+    if (not entry) {
+        return {};
+    }
+    // without the newline that the source buffer appends
+    const auto bytes = std::as_bytes(std::span{ entry->view() });
+    auto reader = EntryReader{ file_id, bytes.first(bytes.size() - 1) };
+    return reader.program(key, source_code);
+}
+
+void ModuleCache::store(const FileId file_id, const std::span<const Token> tokens, const Program& program) const {
+    auto writer = EntryWriter{ tokens };
+    writer.write(program);
+    if (writer.failed()) {
+        return;
+    }
+
+    const auto source_code = SourceFiles::get(file_id).source_code();
+    const auto key = cache_key(source_code);
+    const auto words = writer.words();
+    const auto header = EntryHeader{
+        .magic = magic,
+        .format_version = format_version,
+        .key = key,
+        .source_length = source_code.length(),
+        .num_tokens = static_cast<u32>(tokens.size()),
+        .num_words = static_cast<u32>(words.size()),
+    };
+
+    auto contents = std::vector<std::byte>{};
+    contents.reserve(sizeof(header) + tokens.size() * 2 * sizeof(u32) + words.size_bytes());
+    append(contents, header);
+    for (const auto token : tokens) {
+        append(contents, static_cast<u32>(token.offset()));
+        append(contents, static_cast<u32>(token.length() << 8 | std::to_underlying(token.type())));
+    }
+    for (const auto word : words) {
+        append(contents, word);
+    }
+
+    // Other processes may load or store the same entry at the same time, so the entry is written to a file
+    // with a unique name first and then renamed, which atomically replaces any existing entry.
+    const auto path = entry_path(key);
+    auto temporary_path = path;
+    auto random = std::random_device{};
+    temporary_path += fmt::format(".{:08x}{:08x}.tmp", random(), random());
+    auto file = std::ofstream{ temporary_path, std::ios::out | std::ios::binary | std::ios::trunc };
+    file.write(reinterpret_cast<const char*>(contents.data()), static_cast<std::streamsize>(contents.size()));
+    file.close();
+
+    auto error = std::error_code{};
+    if (not file) {
+        std::filesystem::remove(temporary_path, error);
+        return;
+    }
+    std::filesystem::rename(temporary_path, path, error);
+    if (error) {
+        std::filesystem::remove(temporary_path, error);
+    }
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "parser_nodes/parser_nodes.hpp"
+#include "source_files.hpp"
+#include "tokens.hpp"
+#include "types.hpp"
+#include <filesystem>
+#include <span>
+
+// On-disk cache of the tokens and the syntax tree of modules, so unchanged modules don't have to be lexed and
+// parsed again. Entries are keyed by a hash of the source code and the compiler version. They store the tokens
+// without their file id, followed by the syntax tree which refers to the tokens by index. Both are rebuilt for
+// the file id of the module that is loaded, so all source locations stay valid.
+struct ModuleCache final {
+private:
+    std::filesystem::path m_directory;
+
+    [[nodiscard]] std::filesystem::path entry_path(u64 key) const;
+
+public:
+    explicit ModuleCache(std::filesystem::path directory);
+
+    // returns nothing if there is no valid entry for the source code of the file
+    [[nodiscard]] Optional<parser_nodes::Program> load(FileId file_id) const;
+
+    // the module is just not cached if the entry cannot be written
+    void store(FileId file_id, std::span<const Token> tokens, const parser_nodes::Program& program) const;
+};
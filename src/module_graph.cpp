@@ -0,0 +1,290 @@
+#include "module_graph.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+
+static constexpr auto module_file_extension = std::string_view{ ".bs" };
+
+// e.g. `std/terminal.bs`
+[[nodiscard]] static std::filesystem::path module_path(const parser_nodes::Name& name) {
+    auto result = std::filesystem::path{};
+    for (const auto& token : name.tokens) {
+        if (token.type() == TokenType::Identifier) {
+            result /= token.location().lexeme();
+        }
+    }
+    result += module_file_extension;
+    return result;
+}
+
+[[nodiscard]] static SourceLocation location_of(const parser_nodes::Name& name) {
+    const auto first = name.tokens.front().location();
+    const auto last = name.tokens.back().location();
+    return SourceLocation{ first.file_id(), first.offset(), last.offset() + last.length() - first.offset() };
+}
+
+[[nodiscard]] static PhaseCounts program_counts(const parser_nodes::Program& program) {
+    return PhaseCounts{ count_nodes(program), program.arena->num_allocated_bytes() };
+}
+
+struct NameHash final {
+    [[nodiscard]] usize operator()(const parser_nodes::Name& name) const {
+        return name.hash();
+    }
+};
+
+// different paths to the same file have to end up as the same module
+[[nodiscard]] static std::filesystem::path canonical_path(const std::filesystem::path& path) {
+    auto error = std::error_code{};
+    auto result = std::filesystem::weakly_canonical(path, error);
+    if (error) {
+        return path.lexically_normal();
+    }
+    return result;
+}
+
+struct ModuleGraphBuilder final {
+private:
+    std::span<const std::filesystem::path> m_search_paths;
+    ThreadPool& m_pool;
+    const ModuleCache* m_cache;
+    Statistics* m_statistics;
+    ResidentModules* m_resident_modules;
+
+    std::mutex m_mutex;
+    std::condition_variable m_all_modules_loaded;
+    // every module gets its slot when it is first imported, the slot is filled in as soon as it is loaded
+    std::deque<std::unique_ptr<Module>> m_modules;
+    std::unordered_map<std::string, usize> m_modules_by_path;
+    // results of previous lookups, no matter which module did the import (the names point into the syntax trees
+    // of the importing modules, which outlive the builder)
+    std::unordered_map<parser_nodes::Name, Optional<usize>, NameHash> m_modules_by_name;
+    usize m_num_pending_modules{ 0 };
+
+public:
+    ModuleGraphBuilder(
+            const std::span<const std::filesystem::path> search_paths,
+            ThreadPool& pool,
+            const ModuleCache* const cache,
+            Statistics* const statistics,
+            ResidentModules* const resident_modules
+    )
+        : m_search_paths{ search_paths },
+          m_pool{ pool },
+          m_cache{ cache },
+          m_statistics{ statistics },
+          m_resident_modules{ resident_modules } { }
+
+    // returns the index of the module, the module is loaded if this is the first time it has been added
+    [[nodiscard]] usize add(const std::filesystem::path& path) {
+        auto slot = static_cast<std::unique_ptr<Module>*>(nullptr);
+        auto index = usize{ 0 };
+        {
+            const auto lock = std::scoped_lock{ m_mutex };
+            const auto [iterator, inserted] = m_modules_by_path.try_emplace(path.string(), m_modules.size());
+            if (not inserted) {
+                return iterator->second;
+            }
+            index = m_modules.size();
+            slot = &m_modules.emplace_back();
+            ++m_num_pending_modules;
+        }
+
+        m_pool.submit([this, slot, path]() {
+            *slot = std::make_unique<Module>(load(path));
+
+            const auto lock = std::scoped_lock{ m_mutex };
+            --m_num_pending_modules;
+            if (m_num_pending_modules == 0) {
+                // notifying while holding the lock keeps the builder alive until the notification is done
+                m_all_modules_loaded.notify_all();
+            }
+        });
+        return index;
+    }
+
+    [[nodiscard]] ModuleGraph finish(std::vector<usize> main_modules) {
+        auto lock = std::unique_lock{ m_mutex };
+        m_all_modules_loaded.wait(lock, [&]() { return m_num_pending_modules == 0; });
+
+        auto result = ModuleGraph{ {}, std::move(main_modules) };
+        result.modules.reserve(m_modules.size());
+        for (auto& module : m_modules) {
+            result.modules.push_back(std::move(*module));
+        }
+        return result;
+    }
+
+private:
+    [[nodiscard]] Module load(const std::filesystem::path& path) {
+        auto read_file_timer = PhaseTimer{ m_statistics, Phase::ReadFile, path };
+        const auto file_id =
+                (m_resident_modules != nullptr ? m_resident_modules->load_file(path) : SourceFiles::load(path));
+        if (not file_id) {
+            return Module{ path, Error<ModuleError>{ file_id.error() }, {}, {} };
+        }
+        read_file_timer.stop([&]() { return PhaseCounts{ 0, SourceFiles::get(*file_id).source_code().length() }; });
+
+        auto program = lex_and_parse(path, *file_id);
+        if (not program) {
+            return Module{ path, Error<ModuleError>{ std::move(program.error()) }, {}, {} };
+        }
+
+        auto resolve_imports_timer = PhaseTimer{ m_statistics, Phase::ResolveImports, path };
+        auto imports = std::vector<usize>{};
+        auto unresolved_imports = std::vector<SourceLocation>{};
+        for (const auto& import : program->imports) {
+            const auto imported_module = resolve(import.module_name);
+            if (not imported_module) {
+                unresolved_imports.push_back(location_of(import.module_name));
+            } else if (std::ranges::find(imports, *imported_module) == imports.end()) {
+                imports.push_back(*imported_module);
+            }
+        }
+        resolve_imports_timer.stop([&]() { return PhaseCounts{ program->imports.size(), 0 }; });
+        return Module{ path, std::move(*program), std::move(imports), std::move(unresolved_imports) };
+    }
+
+    [[nodiscard]] Result<parser_nodes::Program, ModuleError>
+    lex_and_parse(const std::filesystem::path& path, const FileId file_id) {
+        if (m_resident_modules != nullptr) {
+            auto timer = PhaseTimer{ m_statistics, Phase::LoadFromCache, path };
+            if (auto program = m_resident_modules->program(path, file_id)) {
+                timer.stop([&]() { return program_counts(*program); });
+                return std::move(*program);
+            }
+        }
+        if (m_cache != nullptr) {
+            auto timer = PhaseTimer{ m_statistics, Phase::LoadFromCache, path };
+            if (auto program = m_cache->load(file_id)) {
+                timer.stop([&]() { return program_counts(*program); });
+                if (m_resident_modules != nullptr) {
+                    m_resident_modules->store(path, file_id, *program);
+                }
+                return std::move(*program);
+            }
+        }
+
+        // without the need for all tokens at once, only the tokens of a single round of batches are in memory
+        if (m_cache == nullptr) {
+            auto timer = PhaseTimer{ m_statistics, Phase::TokenizeAndParse, path };
+            auto tokens = TokenStream{ file_id };
+            auto program = parse(tokens, m_pool);
+            if (not program) {
+                return std::visit([](auto&& error) { return Error<ModuleError>{ std::move(error) }; }, program.error());
+            }
+            timer.stop([&]() {
+                const auto counts = program_counts(*program);
+                return PhaseCounts{ counts.num_items, counts.num_bytes + tokens.max_num_buffered() * sizeof(Token) };
+            });
+            if (m_resident_modules != nullptr) {
+                m_resident_modules->store(path, file_id, *program);
+            }
+            return std::move(*program);
+        }
+
+        // the cache stores the tokens along with the nodes, so it needs all of them at once
+        auto tokenize_timer = PhaseTimer{ m_statistics, Phase::Tokenize, path };
+        auto tokens = tokenize(file_id);
+        if (not tokens) {
+            return Error<ModuleError>{ tokens.error() };
+        }
+        tokenize_timer.stop([&]() { return PhaseCounts{ tokens->size(), tokens->capacity() * sizeof(Token) }; });
+
+        auto parse_timer = PhaseTimer{ m_statistics, Phase::Parse, path };
+        auto program = parse(*tokens, m_pool);
+        if (not program) {
+            return Error<ModuleError>{ std::move(program.error()) };
+        }
+        parse_timer.stop([&]() { return program_counts(*program); });
+
+        {
+            const auto timer = PhaseTimer{ m_statistics, Phase::StoreInCache, path };
+            m_cache->store(file_id, *tokens, *program);
+        }
+        if (m_resident_modules != nullptr) {
+            m_resident_modules->store(path, file_id, *program);
+        }
+        return std::move(*program);
+    }
+
+    [[nodiscard]] Optional<usize> resolve(const parser_nodes::Name& name) {
+        {
+            const auto lock = std::scoped_lock{ m_mutex };
+            const auto iterator = m_modules_by_name.find(name);
+            if (iterator != m_modules_by_name.end()) {
+                return iterator->second;
+            }
+        }
+
+        // another thread may be resolving the same name right now, the module is still only added once
+        auto result = Optional<usize>{};
+        const auto relative_path = module_path(name);
+        for (const auto& search_path : m_search_paths) {
+            const auto path = search_path / relative_path;
+            auto error = std::error_code{};
+            if (std::filesystem::is_regular_file(path, error)) {
+                result = add(canonical_path(path));
+                break;
+            }
+        }
+
+        const auto lock = std::scoped_lock{ m_mutex };
+        m_modules_by_name.try_emplace(name, result);
+        return result;
+    }
+};
+
+[[nodiscard]] bool ModuleGraph::has_errors() const {
+    return std::ranges::any_of(modules, [](const Module& module) {
+        return not module.program.has_value() or not module.unresolved_imports.empty();
+    });
+}
+
+[[nodiscard]] std::vector<std::vector<usize>> ModuleGraph::ordered_modules() const {
+    auto result = std::vector<std::vector<usize>>{};
+    result.reserve(main_modules.size());
+    auto visited = std::vector<bool>(modules.size(), false);
+    auto stack = std::vector<usize>{};
+    for (const auto main_module : main_modules) {
+        auto& group = result.emplace_back();
+        stack.push_back(main_module);
+        while (not stack.empty()) {
+            const auto index = stack.back();
+            stack.pop_back();
+            if (visited[index]) {
+                continue;
+            }
+            visited[index] = true;
+            group.push_back(index);
+            // reversed, so that the first import is visited first
+            const auto& imports = modules[index].imports;
+            stack.insert(stack.end(), imports.rbegin(), imports.rend());
+        }
+    }
+    return result;
+}
+
+[[nodiscard]] ModuleGraph build_module_graph(
+        const std::span<const std::filesystem::path> main_module_paths,
+        const std::span<const std::filesystem::path> search_paths,
+        ThreadPool& pool,
+        const ModuleCache* const cache,
+        Statistics* const statistics,
+        ResidentModules* const resident_modules
+) {
+    auto builder = ModuleGraphBuilder{ search_paths, pool, cache, statistics, resident_modules };
+    auto main_modules = std::vector<usize>{};
+    main_modules.reserve(main_module_paths.size());
+    for (const auto& path : main_module_paths) {
+        main_modules.push_back(builder.add(canonical_path(path)));
+    }
+    return builder.finish(std::move(main_modules));
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "lexer.hpp"
+#include "module_cache.hpp"
+#include "parser.hpp"
+#include "resident_modules.hpp"
+#include "statistics.hpp"
+#include "source_location.hpp"
+#include "thread_pool.hpp"
+#include "types.hpp"
+#include "utils.hpp"
+#include <filesystem>
+#include <span>
+#include <variant>
+#include <vector>
+
+using ModuleError = std::variant<utils::IoError, LexerError, ParserErrors>;
+
+struct Module final {
+    std::filesystem::path path;
+    Result<parser_nodes::Program, ModuleError> program;
+    // indices of the imported modules, every module only appears once
+    std::vector<usize> imports;
+    // locations of the module names of imports that could not be found in any search path
+    std::vector<SourceLocation> unresolved_imports;
+};
+
+// All modules that are (directly or indirectly) imported by the main modules.
+struct ModuleGraph final {
+    std::vector<Module> modules;
+    // index of the module of every main module path, in the order they were given
+    std::vector<usize> main_modules;
+
+    [[nodiscard]] bool has_errors() const;
+
+    // Every module exactly once, grouped by the first main module that (directly or indirectly) imports it: each
+    // main module is followed by the modules it imports (depth first, in the order of the imports) which have not
+    // been reached from a previous main module. Unlike the order of the modules themselves, this order does not
+    // depend on which thread loaded which module first.
+    [[nodiscard]] std::vector<std::vector<usize>> ordered_modules() const;
+};
+
+// Maps a module name like `std::terminal` to the path `std/terminal.bs` relative to the first search path
+// that contains it. Modules are loaded, lexed and parsed on the pool as soon as they are imported, every
+// module only once no matter how many modules import it (or under which path). This also holds for the main
+// modules, which are all loaded in parallel. Modules whose source code is found in the cache (if any) are not
+// lexed and parsed again, all other modules are stored in it. The same holds for the resident modules (if any),
+// which are looked up before the cache. The phases of every module are recorded in the statistics (if any).
+[[nodiscard]] ModuleGraph build_module_graph(
+        std::span<const std::filesystem::path> main_module_paths,
+        std::span<const std::filesystem::path> search_paths,
+        ThreadPool& pool,
+        const ModuleCache* cache = nullptr,
+        Statistics* statistics = nullptr,
+        ResidentModules* resident_modules = nullptr
+);
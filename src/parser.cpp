@@ -1,115 +1,258 @@
 #include "parser.hpp"
-#include <exception>
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <limits>
+#include <span>
+#include <tuple>
 #include <utility>
+#include <vector>
 
 using namespace parser_nodes;
 
-enum class Throwing {
-    Yes,
-    No,
+[[nodiscard]] static bool is_definition_keyword(const TokenType type) {
+    using enum TokenType;
+    return type == Function or type == Type or type == Struct or type == Import;
+}
+
+// parsing never ends before the end of file token without an explicit end
+static constexpr auto no_end = std::numeric_limits<usize>::max();
+
+// Random access to all tokens of a file, which allows parsing top level definitions in parallel (and starting
+// anywhere). Like a TokenStream, indices behind the end of file token refer to the end of file token.
+struct TokenVectorSource final {
+private:
+    std::span<const Token> m_tokens;
+
+public:
+    explicit TokenVectorSource(const TokenVector& tokens) : m_tokens{ tokens } {
+        assert(not m_tokens.empty() and m_tokens.back().type() == TokenType::EndOfFile);
+    }
+
+    [[nodiscard]] Token at(const usize index) const {
+        return m_tokens[std::min(index, m_tokens.size() - 1)];
+    }
+
+    void release(usize) const { }
 };
 
-struct ParserSynchronization : public std::exception { };
+// Top level definitions start with a definition keyword (or `export`) outside of any curly brackets, so they
+// can be found without parsing them. Returns the index of the next top level definition after the one that
+// starts at the given index (which has to be outside of any curly brackets), or the index of the end of file.
+template<typename Tokens>
+[[nodiscard]] static usize next_top_level_definition(Tokens& tokens, const usize start) {
+    auto depth = usize{ 0 };
+    auto index = start;
+    auto previous_type = TokenType::EndOfFile;
+    for (auto type = tokens.at(index).type(); type != TokenType::EndOfFile; type = tokens.at(++index).type()) {
+        if (type == TokenType::LeftCurlyBracket) {
+            ++depth;
+        } else if (type == TokenType::RightCurlyBracket and depth > 0) {
+            --depth;
+        } else if (depth == 0 and index > start) {
+            const auto follows_export = (previous_type == TokenType::Export);
+            if (type == TokenType::Export or (is_definition_keyword(type) and not follows_export)) {
+                break;
+            }
+        }
+        previous_type = type;
+    }
+    return index;
+}
 
+// Collects the elements of a list on top of a scratch buffer until they are copied into the arena. Nested
+// lists of the same element type stack up in the same buffer, so the buffers are reused across all lists.
+template<typename T>
+struct ScratchList final {
+private:
+    std::vector<T>& m_buffer;
+    usize m_start;
+
+public:
+    explicit ScratchList(std::vector<T>& buffer) : m_buffer{ buffer }, m_start{ buffer.size() } { }
+
+    ScratchList(const ScratchList&) = delete;
+    ScratchList& operator=(const ScratchList&) = delete;
+
+    ~ScratchList() {
+        m_buffer.erase(m_buffer.begin() + static_cast<std::ptrdiff_t>(m_start), m_buffer.end());
+    }
+
+    void push_back(T element) {
+        m_buffer.push_back(std::move(element));
+    }
+
+    [[nodiscard]] std::span<const T> copy_to(Arena& arena) const {
+        return arena.copy(std::span<const T>{ m_buffer }.subspan(m_start));
+    }
+};
+
+// The tokens are either a TokenVectorSource or a TokenStream. Tokens in front of the current top level definition
+// are released, since the nodes only contain copies of them.
+template<typename Tokens>
 struct ParserState {
 private:
-    TokenVector m_tokens;
+    Tokens& m_tokens;
     usize m_index{ 0 };
+    usize m_end{ no_end }; // end of the top level definitions that are parsed
     ParserErrors m_errors{};
+    // After an error, the parser is synchronizing: consuming tokens fails without reporting further errors
+    // and without advancing, so the nodes that are still being built only contain placeholder tokens. The
+    // functions that are able to recover discard these nodes and skip ahead to where parsing can resume.
+    bool m_synchronizing{ false };
+    std::unique_ptr<Arena> m_arena{ std::make_unique<Arena>() };
+    std::tuple<std::vector<Token>, std::vector<Parameter>, std::vector<ImportStatement>, std::vector<const Statement*>>
+            m_scratch_buffers;
+    // Recovering from an error never skips into the next top level definition, so the definitions can also be
+    // parsed independently of each other. The end of the current definition is only looked up after an error,
+    // starting from a position in the definition (or the stray tokens following it) outside of curly brackets.
+    usize m_definition_start{ 0 };
+    tl::optional<usize> m_definition_end{};
 
 public:
-    explicit ParserState(TokenVector&& tokens) : m_tokens{ std::move(tokens) } { }
+    explicit ParserState(Tokens& tokens) : m_tokens{ tokens } { }
+
+    ParserState(Tokens& tokens, std::unique_ptr<Arena> arena) : m_tokens{ tokens }, m_arena{ std::move(arena) } { }
 
-    [[nodiscard]] tl::expected<Program, ParserErrors> parse() {
-        auto result = program();
-        if (result) {
-            return std::move(*result);
+    [[nodiscard]] usize index() const {
+        return m_index;
+    }
+
+    [[nodiscard]] const ParserErrors& errors() const {
+        return m_errors;
+    }
+
+    [[nodiscard]] std::span<const ImportStatement> import_statements() {
+        auto imports = scratch_list<ImportStatement>();
+        while (const auto import_token = try_consume(TokenType::Import)) {
+            auto module_name = name();
+            const auto semicolon_token = consume(TokenType::Semicolon);
+            if (stop_synchronizing()) {
+                synchronize(no_end);
+            } else {
+                imports.push_back(ImportStatement{ *import_token, std::move(module_name), semicolon_token });
+            }
         }
-        return tl::unexpected{ std::move(m_errors) };
+        return imports.copy_to(*m_arena);
     }
 
-private:
-    [[nodiscard]] tl::optional<Program> program() {
-        auto imports = import_statements();
+    [[nodiscard]] Arena& arena() {
+        return *m_arena;
+    }
 
-        auto definitions = this->definitions();
+    // the nodes stay where they are, but the state cannot be used anymore
+    [[nodiscard]] std::unique_ptr<Arena> arena_moved() {
+        return std::move(m_arena);
+    }
 
-        if (not is_end_of_input()) {
-            error(ParserError{ current(), ErrorCode::UnexpectedToken });
+    // parses the top level definitions in [begin, end), the first one has to start at begin
+    void definitions(const usize begin, const usize end, std::vector<const Statement*>& results) {
+        definitions(begin, end, results, [](usize) { return false; });
+    }
+
+    // stops in front of the first top level definition for which stop(index of its first token) is true
+    template<typename StopPredicate>
+    void definitions(
+            const usize begin,
+            const usize end,
+            std::vector<const Statement*>& results,
+            StopPredicate stop
+    ) {
+        m_index = begin;
+        m_end = end;
+        m_definition_start = begin;
+        m_definition_end = tl::nullopt;
+        while (m_index < m_end and not is_end_of_input()) {
+            if (m_definition_end and m_index >= *m_definition_end) {
+                m_definition_end = tl::nullopt;
+            }
+            if (not m_definition_end) {
+                if (stop(m_index)) {
+                    return;
+                }
+                // without errors, every definition ends outside of any curly brackets
+                m_definition_start = m_index;
+                m_tokens.release(m_index);
+            }
+            const auto export_token = try_consume(TokenType::Export);
+            const auto definition = this->definition(export_token);
+            if (stop_synchronizing()) {
+                // the broken definition extends up to the next top level definition
+                m_index = definition_end();
+            } else {
+                results.push_back(definition);
+            }
         }
+    }
 
-        const auto successful = m_errors.empty();
+    // takes over the nodes and the errors of a state that parsed the definitions following the ones of this state
+    template<typename OtherTokens>
+    void append(ParserState<OtherTokens>&& other) {
+        m_arena->absorb(std::move(*other.arena_moved()));
+        m_errors.insert(m_errors.end(), other.errors().begin(), other.errors().end());
+    }
 
+    [[nodiscard]] tl::expected<Program, ParserErrors> program(
+            const std::span<const ImportStatement> imports,
+            const std::span<const Statement* const> definitions
+    ) {
+        const auto successful = m_errors.empty();
         if (successful) {
-            return Program{ std::move(imports), std::move(definitions) };
+            const auto arena_definitions = m_arena->copy(definitions);
+            return Program{ std::move(m_arena), imports, arena_definitions };
         }
-        return {};
+        return tl::unexpected{ std::move(m_errors) };
     }
 
-    [[nodiscard]] std::vector<ImportStatement> import_statements() {
-        auto imports = std::vector<ImportStatement>{};
-        while (const auto import_token = try_consume(TokenType::Import)) {
-            try {
-                auto module_name = name();
-                const auto semicolon_token = consume(TokenType::Semicolon);
-                imports.emplace_back(*import_token, std::move(module_name), semicolon_token);
-            } catch ([[maybe_unused]] const ParserSynchronization& sync) {
-                synchronize();
-            }
-        }
-        return imports;
+private:
+    template<typename T>
+    [[nodiscard]] ScratchList<T> scratch_list() {
+        return ScratchList<T>{ std::get<std::vector<T>>(m_scratch_buffers) };
     }
 
-    [[nodiscard]] std::unique_ptr<Statement> definition(tl::optional<Token> export_token) {
-        switch (current().type) {
+    [[nodiscard]] const Statement* definition(tl::optional<Token> export_token) {
+        switch (current().type()) {
             case TokenType::Function:
                 return function(export_token);
             default:
-                error(ParserError{ current(), ErrorCode::UnexpectedToken }, Throwing::No);
-                synchronize();
+                // recovers on its own
+                m_errors.push_back(ParserError{ current(), ErrorCode::UnexpectedToken });
+                synchronize(definition_end());
                 return {};
         }
     }
 
-    [[nodiscard]] std::vector<std::unique_ptr<Statement>> definitions() {
-        auto results = std::vector<std::unique_ptr<Statement>>{};
-        while (not is_end_of_input()) {
-            const auto export_token = try_consume(TokenType::Export);
-            results.push_back(definition(export_token));
-        }
-        return results;
-    }
-
-    [[nodiscard]] static bool is_definition_keyword(const TokenType type) {
-        using enum TokenType;
-        return type == Function or type == Type or type == Struct or type == Import;
-    }
-
-    [[nodiscard]] std::unique_ptr<Statement> statement() {
+    [[nodiscard]] const Statement* statement() {
         const auto export_token = try_consume(TokenType::Export);
-        const auto is_definition = (export_token or is_definition_keyword(current().type));
+        const auto is_definition = (export_token or is_definition_keyword(current().type()));
         if (is_definition) {
             return definition(export_token);
         }
-        // statement, but not a definition
-        // todo
-        assert(false and "not implemented");
+        // statement, but not a definition (there are none yet), recovers on its own
+        m_errors.push_back(ParserError{ current(), ErrorCode::UnexpectedToken });
+        synchronize_block();
         return {};
     }
 
-    [[nodiscard]] std::vector<std::unique_ptr<Statement>> statements() {
-        auto results = std::vector<std::unique_ptr<Statement>>{};
-        while (not is_end_of_input() and not current_is(TokenType::RightCurlyBracket)) {
+    [[nodiscard]] std::span<const Statement* const> statements() {
+        auto results = scratch_list<const Statement*>();
+        while (not m_synchronizing and not is_end_of_input() and not current_is(TokenType::RightCurlyBracket)) {
+            const auto start = m_index;
             results.push_back(statement());
+            // after an error, a statement may not get any further (e.g. at the start of the next top level definition)
+            if (m_index == start) {
+                break;
+            }
         }
-        return results;
+        return results.copy_to(*m_arena);
     }
 
     [[nodiscard]] Block block() {
         const auto left_curly_bracket = consume(TokenType::LeftCurlyBracket);
-        auto statements = this->statements();
+        const auto statements = this->statements();
         const auto right_curly_bracket = consume(TokenType::RightCurlyBracket);
-        return Block{ left_curly_bracket, std::move(statements), right_curly_bracket };
+        return Block{ left_curly_bracket, statements, right_curly_bracket };
     }
 
     template<TokenType... token_types>
@@ -119,35 +262,40 @@ private:
         } else if constexpr (sizeof...(token_types) > 1) {
             return std::tuple{ consume(token_types)... };
         } else {
-            throw; // zero arguments are not allowed
+            static_assert(sizeof...(token_types) > 0, "zero arguments are not allowed");
         }
     }
 
-    [[nodiscard]] std::unique_ptr<Statement> function([[maybe_unused]] tl::optional<Token> export_token) {
-        assert(current().type == TokenType::Function);
-        [[maybe_unused]] const auto [function_token, identifier_token] = consume<TokenType::Function, TokenType::Identifier>();
-        [[maybe_unused]] auto type_parameter_list = this->type_parameter_list();
-        [[maybe_unused]] auto parameter_list = this->type_parameter_list();
-        [[maybe_unused]] auto return_type = this->return_type();
-        return {};
-        // todo
-        // return std::make_unique<FunctionDefinition>(export_token, function_token, identifier_token, type_parameter_list, parameter_list, return_type, )
+    [[nodiscard]] const Statement* function(const tl::optional<Token> export_token) {
+        assert(current().type() == TokenType::Function);
+        const auto [function_token, identifier_token] = consume<TokenType::Function, TokenType::Identifier>();
+        auto type_parameter_list = this->type_parameter_list();
+        auto parameter_list = this->parameter_list();
+        auto return_type = tl::optional<ReturnType>{};
+        if (current_is(TokenType::TildeArrow)) {
+            return_type = this->return_type();
+        }
+        auto body = block();
+        return m_arena->create<FunctionDefinition>(
+                export_token, function_token, identifier_token, std::move(type_parameter_list),
+                std::move(parameter_list), std::move(return_type), std::move(body)
+        );
     }
 
     template<
             TokenType start_token,
             TokenType end_token,
             typename ElementParser,
-            typename Elements = std::vector<std::remove_cvref_t<decltype(std::declval<ElementParser>()())>>,
-            typename ReturnType = tl::optional<std::tuple<Token, Elements, Token>>>
+            typename Element = std::remove_cvref_t<decltype(std::declval<ElementParser>()())>,
+            typename ReturnType = tl::optional<std::tuple<Token, std::span<const Element>, Token>>>
     [[nodiscard]] ReturnType try_parse_list_with_optional_trailing_comma(ElementParser element_parser) {
         const auto start = try_consume(start_token);
         if (not start) {
             return {};
         }
 
-        auto elements = Elements{};
-        while (not is_end_of_input() and current().type != end_token) {
+        auto elements = scratch_list<Element>();
+        while (not is_end_of_input() and current().type() != end_token) {
             elements.push_back(element_parser());
             const auto comma_token = try_consume(TokenType::Comma);
             if (not comma_token) {
@@ -155,21 +303,21 @@ private:
             }
         }
         const auto end = consume<end_token>();
-        return std::tuple{ *start, std::move(elements), end };
+        return std::tuple{ *start, elements.copy_to(*m_arena), end };
     }
 
     template<
             TokenType start_token,
             TokenType end_token,
             typename ElementParser,
-            typename Elements = std::vector<std::remove_cvref_t<decltype(std::declval<ElementParser>()())>>,
-            typename ReturnType = std::tuple<Token, Elements, Token>>
+            typename Element = std::remove_cvref_t<decltype(std::declval<ElementParser>()())>,
+            typename ReturnType = std::tuple<Token, std::span<const Element>, Token>>
     [[nodiscard]] ReturnType parse_list_with_optional_trailing_comma(ElementParser element_parser) {
         auto result = try_parse_list_with_optional_trailing_comma<start_token, end_token>(element_parser);
         if (not result) {
             // try (again) to consume start token to force regular error reporting
-            std::ignore = consume<start_token>(); // throws
-            std::unreachable();
+            const auto placeholder = consume<start_token>();
+            return ReturnType{ placeholder, {}, placeholder };
         }
         return std::move(*result);
     }
@@ -182,18 +330,18 @@ private:
         if (not list) {
             return {};
         }
-        auto [left_curly_bracket, type_identifiers, right_curly_bracket] = *list;
-        return TypeParameterList{ left_curly_bracket, std::move(type_identifiers), right_curly_bracket };
+        const auto [left_curly_bracket, type_identifiers, right_curly_bracket] = *list;
+        return TypeParameterList{ left_curly_bracket, type_identifiers, right_curly_bracket };
     }
 
     [[nodiscard]] ParameterList parameter_list() {
-        auto [left_parenthesis, list, right_parenthesis] =
+        const auto [left_parenthesis, list, right_parenthesis] =
                 parse_list_with_optional_trailing_comma<TokenType::LeftParenthesis, TokenType::RightParenthesis>([&]() {
                     const auto [identifier, _] = consume<TokenType::Identifier, TokenType::Colon>();
                     auto type_name = name();
                     return Parameter{ identifier, std::move(type_name) };
                 });
-        return ParameterList{ left_parenthesis, std::move(list), right_parenthesis };
+        return ParameterList{ left_parenthesis, list, right_parenthesis };
     }
 
     [[nodiscard]] ReturnType return_type() {
@@ -203,56 +351,92 @@ private:
         return ReturnType{ tilde_arrow, std::move(type_name) };
     }
 
-    void synchronize() {
-        while (not is_end_of_input() and current().type != TokenType::Semicolon) {
+    // skips up to (and including) the next semicolon before the given index
+    void synchronize(const usize end) {
+        while (m_index < end and not is_end_of_input() and current().type() != TokenType::Semicolon) {
+            advance();
+        }
+        if (m_index < end and not is_end_of_input()) {
+            assert(current().type() == TokenType::Semicolon);
             advance();
         }
-        if (not is_end_of_input()) {
-            assert(current().type == TokenType::Semicolon);
+    }
+
+    // skips up to (but excluding) the curly bracket that closes the current block, without leaving the definition
+    void synchronize_block() {
+        const auto end = definition_end();
+        auto depth = usize{ 0 };
+        while (m_index < end and not is_end_of_input()) {
+            if (current_is(TokenType::LeftCurlyBracket)) {
+                ++depth;
+            } else if (current_is(TokenType::RightCurlyBracket)) {
+                if (depth == 0) {
+                    return;
+                }
+                --depth;
+            }
             advance();
         }
     }
 
+    [[nodiscard]] usize definition_end() {
+        if (not m_definition_end) {
+            m_definition_end = std::min(next_top_level_definition(m_tokens, m_definition_start), m_end);
+        }
+        return *m_definition_end;
+    }
+
+    // returns whether an error occurred since the last call
+    [[nodiscard]] bool stop_synchronizing() {
+        return std::exchange(m_synchronizing, false);
+    }
+
     [[nodiscard]] Name name() {
-        auto tokens = std::vector<Token>{};
+        auto tokens = scratch_list<Token>();
         tokens.push_back(consume(TokenType::Identifier));
         while (const auto double_colon_token = try_consume(TokenType::DoubleColon)) {
             tokens.push_back(*double_colon_token);
             tokens.push_back(consume(TokenType::Identifier));
         }
-        return Name{ std::move(tokens) };
+        return Name{ tokens.copy_to(*m_arena) };
     }
 
-    [[nodiscard]] const Token& current() const {
+    [[nodiscard]] Token current() {
         return m_tokens.at(m_index);
     }
 
-    [[nodiscard]] bool current_is(const TokenType type) const {
-        return current().type == type;
+    [[nodiscard]] bool current_is(const TokenType type) {
+        return current().type() == type;
     }
 
-    [[nodiscard]] const Token& peek() const {
+    [[nodiscard]] Token peek() {
         return m_tokens.at(m_index + 1);
     }
 
-    [[nodiscard]] tl::optional<const Token&> try_consume(const TokenType type) {
-        if (current().type != type) {
+    [[nodiscard]] tl::optional<Token> try_consume(const TokenType type) {
+        if (m_synchronizing or current().type() != type) {
             return {};
         }
         return m_tokens.at(m_index++);
     }
 
-    [[nodiscard]] const Token& consume(const TokenType type) {
-        if (current().type != type) {
+    // returns the current token as a placeholder (without advancing) if it does not match
+    [[nodiscard]] Token consume(const TokenType type) {
+        if (m_synchronizing) {
+            return current();
+        }
+        if (current().type() != type) {
             error(ParserError{ current(), ErrorCode::UnexpectedToken, type });
+            return current();
         }
         return m_tokens.at(m_index++);
     }
 
-    void error(const ParserError error, const Throwing shouldThrow = Throwing::Yes) {
-        m_errors.push_back(error);
-        if (shouldThrow == Throwing::Yes) {
-            throw ParserSynchronization{};
+    // only the first error is reported, the parser is synchronizing until it reaches a point to recover from
+    void error(const ParserError error) {
+        if (not m_synchronizing) {
+            m_errors.push_back(error);
+            m_synchronizing = true;
         }
     }
 
@@ -260,12 +444,438 @@ private:
         m_index += amount;
     }
 
-    [[nodiscard]] bool is_end_of_input() const {
-        return m_index >= m_tokens.size() or current().type == TokenType::EndOfFile;
+    [[nodiscard]] bool is_end_of_input() {
+        return current().type() == TokenType::EndOfFile;
     }
 };
 
-[[nodiscard]] tl::expected<Program, ParserErrors> parse(TokenVector&& tokens) {
-    auto parser_state = ParserState{ std::move(tokens) };
-    return parser_state.parse();
+// below this size, distributing the definitions costs more than parsing them
+static constexpr usize min_tokens_per_batch = 16 * 1024;
+// more batches than threads balance the load if the definitions differ in size
+static constexpr usize batches_per_thread = 4;
+
+[[nodiscard]] static tl::expected<Program, ParserErrors> parse(const TokenVector& tokens, ThreadPool* const pool) {
+    auto source = TokenVectorSource{ tokens };
+    auto state = ParserState{ source };
+    const auto imports = state.import_statements();
+    auto definitions = std::vector<const Statement*>{};
+
+    const auto begin = state.index();
+    const auto num_tokens = tokens.size() - begin;
+    const auto max_num_batches = (pool == nullptr ? usize{ 1 } : pool->num_threads() * batches_per_thread);
+    const auto num_batches = std::clamp(num_tokens / min_tokens_per_batch, usize{ 1 }, max_num_batches);
+    if (num_batches == 1) {
+        state.definitions(begin, no_end, definitions);
+        return state.program(imports, definitions);
+    }
+
+    // every batch consists of whole top level definitions and gets about the same number of tokens
+    auto batch_boundaries = std::vector<usize>{ begin };
+    auto index = begin;
+    while (index < tokens.size() and tokens[index].type() != TokenType::EndOfFile) {
+        index = next_top_level_definition(source, index);
+        if (index - batch_boundaries.back() >= num_tokens / num_batches) {
+            batch_boundaries.push_back(index);
+        }
+    }
+    if (batch_boundaries.back() != index) {
+        batch_boundaries.push_back(index);
+    }
+
+    const auto actual_num_batches = batch_boundaries.size() - 1;
+    auto batch_states = std::vector<ParserState<TokenVectorSource>>{};
+    batch_states.reserve(actual_num_batches);
+    for (usize i = 0; i < actual_num_batches; ++i) {
+        batch_states.emplace_back(source);
+    }
+    auto batch_definitions = std::vector<std::vector<const Statement*>>(actual_num_batches);
+    pool->for_each_index(actual_num_batches, [&](const usize batch) {
+        batch_states[batch].definitions(batch_boundaries[batch], batch_boundaries[batch + 1], batch_definitions[batch]);
+    });
+
+    // merging in the order of the batches keeps both the definitions and the errors in source order
+    for (usize i = 0; i < actual_num_batches; ++i) {
+        state.append(std::move(batch_states[i]));
+        definitions.insert(definitions.end(), batch_definitions[i].begin(), batch_definitions[i].end());
+    }
+    return state.program(imports, definitions);
+}
+
+[[nodiscard]] tl::expected<Program, ParserErrors> parse(const TokenVector& tokens) {
+    return parse(tokens, nullptr);
+}
+
+[[nodiscard]] tl::expected<Program, ParserErrors> parse(const TokenVector& tokens, ThreadPool& pool) {
+    return parse(tokens, &pool);
+}
+
+[[nodiscard]] tl::expected<Program, LexerOrParserErrors> parse(TokenStream& tokens) {
+    auto state = ParserState{ tokens };
+    const auto imports = state.import_statements();
+    auto definitions = std::vector<const Statement*>{};
+    state.definitions(state.index(), no_end, definitions);
+    // the parser errors may only be caused by the lexer error
+    if (tokens.error()) {
+        return tl::unexpected{ LexerOrParserErrors{ *tokens.error() } };
+    }
+    auto program = state.program(imports, definitions);
+    if (not program) {
+        return tl::unexpected{ LexerOrParserErrors{ std::move(program.error()) } };
+    }
+    return std::move(*program);
+}
+
+// The tokens of a round of a parallel parse from a stream, up to the first token behind the round. They have been
+// lexed already, so all batches of the round can read them at the same time. After errors, the parser may look at
+// tokens behind the round, which have not been lexed yet. The batch ends there instead, so it has to be parsed again.
+struct RoundSource final {
+private:
+    const TokenStream& m_stream;
+    usize m_end;
+    bool m_looked_behind{ false };
+
+public:
+    RoundSource(const TokenStream& stream, const usize end) : m_stream{ stream }, m_end{ end } { }
+
+    [[nodiscard]] Token at(const usize index) {
+        const auto token = m_stream.buffered(std::min(index, m_end));
+        if (index <= m_end or token.type() == TokenType::EndOfFile) {
+            return token;
+        }
+        m_looked_behind = true;
+        return Token{ token.location(), TokenType::EndOfFile };
+    }
+
+    void release(usize) const { }
+
+    [[nodiscard]] bool looked_behind() const {
+        return m_looked_behind;
+    }
+};
+
+[[nodiscard]] tl::expected<Program, LexerOrParserErrors> parse(TokenStream& tokens, ThreadPool& pool) {
+    if (pool.num_threads() == 1) {
+        return parse(tokens);
+    }
+    auto state = ParserState{ tokens };
+    const auto imports = state.import_statements();
+    auto definitions = std::vector<const Statement*>{};
+
+    // every round lexes a number of batches of whole top level definitions and parses them in parallel
+    const auto max_num_batches = pool.num_threads() * batches_per_thread;
+    auto index = state.index();
+    while (tokens.at(index).type() != TokenType::EndOfFile) {
+        auto batch_boundaries = std::vector<usize>{ index };
+        while (batch_boundaries.size() <= max_num_batches and tokens.at(index).type() != TokenType::EndOfFile) {
+            index = next_top_level_definition(tokens, index);
+            const auto is_last = (tokens.at(index).type() == TokenType::EndOfFile);
+            if (index - batch_boundaries.back() >= min_tokens_per_batch or is_last) {
+                batch_boundaries.push_back(index);
+            }
+        }
+
+        const auto num_batches = batch_boundaries.size() - 1;
+        auto batch_sources = std::vector<RoundSource>{};
+        batch_sources.reserve(num_batches);
+        auto batch_states = std::vector<ParserState<RoundSource>>{};
+        batch_states.reserve(num_batches);
+        for (usize i = 0; i < num_batches; ++i) {
+            batch_states.emplace_back(batch_sources.emplace_back(tokens, index));
+        }
+        auto batch_definitions = std::vector<std::vector<const Statement*>>(num_batches);
+        pool.for_each_index(num_batches, [&](const usize batch) {
+            const auto begin = batch_boundaries[batch];
+            batch_states[batch].definitions(begin, batch_boundaries[batch + 1], batch_definitions[batch]);
+        });
+
+        for (usize i = 0; i < num_batches; ++i) {
+            if (batch_sources[i].looked_behind()) {
+                // the stream lexes as far ahead as the parser looks
+                state.definitions(batch_boundaries[i], batch_boundaries[i + 1], definitions);
+                continue;
+            }
+            state.append(std::move(batch_states[i]));
+            definitions.insert(definitions.end(), batch_definitions[i].begin(), batch_definitions[i].end());
+        }
+        tokens.release(index);
+    }
+    // the parser errors may only be caused by the lexer error
+    if (tokens.error()) {
+        return tl::unexpected{ LexerOrParserErrors{ *tokens.error() } };
+    }
+    auto program = state.program(imports, definitions);
+    if (not program) {
+        return tl::unexpected{ LexerOrParserErrors{ std::move(program.error()) } };
+    }
+    return std::move(*program);
+}
+
+// the offset of a previous token behind the edit within the edited source code
+[[nodiscard]] static usize edited_offset(const usize previous_offset, const TextEdit& edit) {
+    return previous_offset - edit.length + edit.replacement_length;
+}
+
+[[nodiscard]] static Token edited_end_of_file(const IncrementalProgram& previous, const TextEdit& edit) {
+    const auto& end_of_file = previous.end_of_file;
+    return end_of_file.relocated(end_of_file.file_id(), edited_offset(end_of_file.offset(), edit));
+}
+
+// Tokens of an edited file from where parsing restarts: freshly lexed tokens up to the first one behind the edit that
+// starts where a previous token started (the lexer would produce the previous tokens from there on), followed by
+// copies of the previous tokens. Previous tokens are only copied as far as the parser asks for them.
+struct EditedTokenSource final {
+private:
+    TokenStream m_stream;
+    usize m_num_lexed{ 0 };
+    std::span<const PlacedSection> m_previous_sections;
+    TextEdit m_edit;
+    Optional<Token> m_previous_end_of_file;
+    TokenVector m_tokens;
+    bool m_is_complete{ false };
+    // the parser looked at all tokens in front of this index
+    usize m_num_looked_at{ 0 };
+    // the next previous token to copy (section and index within it), once the lexer is back in sync
+    Optional<std::pair<usize, usize>> m_next_previous;
+    // indices of copied tokens that start a previous section, along with the index of that section
+    std::vector<std::pair<usize, usize>> m_previous_section_starts;
+
+public:
+    // without a previous program, this just lexes the whole file
+    EditedTokenSource(
+            const FileId file_id,
+            const usize offset,
+            const IncrementalProgram* const previous,
+            const TextEdit& edit
+    )
+        : m_stream{ file_id, offset },
+          m_edit{ edit } {
+        if (previous != nullptr) {
+            m_previous_sections = previous->sections;
+            m_previous_end_of_file = edited_end_of_file(*previous, edit);
+        }
+    }
+
+    // indices behind the end of file token refer to the end of file token
+    [[nodiscard]] Token at(const usize index) {
+        while (index >= m_tokens.size() and not m_is_complete) {
+            produce_next();
+        }
+        const auto clamped_index = std::min(index, m_tokens.size() - 1);
+        m_num_looked_at = std::max(m_num_looked_at, clamped_index + 1);
+        return m_tokens[clamped_index];
+    }
+
+    void release(usize) const { }
+
+    [[nodiscard]] std::span<const Token> tokens(const usize begin, const usize end) const {
+        return std::span{ m_tokens }.subspan(begin, end - begin);
+    }
+
+    [[nodiscard]] usize num_looked_at() const {
+        return m_num_looked_at;
+    }
+
+    // the previous section that starts at the token with the given index, if any
+    [[nodiscard]] Optional<usize> previous_section_at(const usize index) const {
+        const auto start =
+                std::ranges::lower_bound(m_previous_section_starts, index, {}, &std::pair<usize, usize>::first);
+        if (start == m_previous_section_starts.end() or start->first != index) {
+            return {};
+        }
+        return start->second;
+    }
+
+    [[nodiscard]] const Optional<LexerError>& error() const {
+        return m_stream.error();
+    }
+
+private:
+    void produce_next() {
+        if (m_next_previous) {
+            copy_next_previous();
+            return;
+        }
+        const auto token = m_stream.at(m_num_lexed);
+        m_stream.release(++m_num_lexed);
+        if (token.type() == TokenType::EndOfFile) {
+            m_tokens.push_back(token);
+            m_is_complete = true;
+            return;
+        }
+        if (token.offset() >= m_edit.offset + m_edit.replacement_length) {
+            m_next_previous = find_previous(token.offset() + m_edit.length - m_edit.replacement_length);
+            if (m_next_previous) {
+                copy_next_previous();
+                return;
+            }
+        }
+        m_tokens.push_back(token);
+    }
+
+    // the previous token that started at the given offset within the previous source code
+    [[nodiscard]] Optional<std::pair<usize, usize>> find_previous(const usize offset) const {
+        const auto starts_up_to_offset = [&](const PlacedSection& placed) {
+            const auto& tokens = placed.section->tokens;
+            return tokens.empty() or placed.offset(tokens.front().offset()) <= offset;
+        };
+        const auto next = std::ranges::partition_point(m_previous_sections, starts_up_to_offset);
+        if (next == m_previous_sections.begin()) {
+            return {};
+        }
+        const auto& placed = *std::prev(next);
+        const auto& tokens = placed.section->tokens;
+        const auto token = std::ranges::lower_bound(tokens, offset, {}, [&](const Token& previous_token) {
+            return placed.offset(previous_token.offset());
+        });
+        if (token == tokens.end() or placed.offset(token->offset()) != offset) {
+            return {};
+        }
+        return std::pair{ static_cast<usize>(std::prev(next) - m_previous_sections.begin()),
+                          static_cast<usize>(token - tokens.begin()) };
+    }
+
+    void copy_next_previous() {
+        auto& [section, index] = *m_next_previous;
+        while (section < m_previous_sections.size() and index == m_previous_sections[section].section->tokens.size()) {
+            ++section;
+            index = 0;
+        }
+        if (section == m_previous_sections.size()) {
+            m_tokens.push_back(*m_previous_end_of_file);
+            m_is_complete = true;
+            return;
+        }
+        if (index == 0) {
+            m_previous_section_starts.emplace_back(m_tokens.size(), section);
+        }
+        const auto& placed = m_previous_sections[section];
+        const auto& token = placed.section->tokens[index];
+        m_tokens.push_back(token.relocated(token.file_id(), edited_offset(placed.offset(token.offset()), m_edit)));
+        ++index;
+    }
+};
+
+// The sections in front of the returned one only depend on tokens in front of the edit, so they stay the same. The
+// returned one starts with a token in front of the edit as well, since the parser looked at it for the previous one.
+// Errors may let the parser look far ahead, so the sections have to be checked one by one.
+[[nodiscard]] static usize restart_section(const std::span<const PlacedSection> sections, const TextEdit& edit) {
+    const auto looked_at_edit = [&](const PlacedSection& placed) {
+        return placed.offset(placed.section->lookahead_end) >= edit.offset;
+    };
+    const auto restart = std::ranges::find_if(sections, looked_at_edit);
+    // the last section looked at the end of file
+    assert(restart != sections.end());
+    return static_cast<usize>(restart - sections.begin());
+}
+
+// the number of definitions and errors (and tokens looked at) when the parser reaches the first token of a section
+struct SectionStart final {
+    usize index;
+    usize num_definitions;
+    usize num_errors;
+    usize num_looked_at;
+};
+
+// small edits only add a few nodes, but the arena stays alive as long as one of its sections is used
+static constexpr usize first_section_chunk_size = 1024;
+
+[[nodiscard]] static Result<IncrementalProgram, LexerError> parse_sections(
+        EditedTokenSource& source,
+        const IncrementalProgram* const previous,
+        const usize restart,
+        const TextEdit& edit
+) {
+    auto state = ParserState{ source, std::make_unique<Arena>(first_section_chunk_size) };
+    auto imports = std::span<const ImportStatement>{};
+    if (restart == 0) {
+        imports = state.import_statements();
+    }
+    const auto begin = state.index();
+
+    // The definitions loop calls the predicate in front of every section. Parsing stops at the first one that
+    // starts with a copied token that started a previous section, since it would produce the previous sections.
+    auto definitions = std::vector<const Statement*>{};
+    auto section_starts = std::vector<SectionStart>{};
+    auto first_reused = Optional<usize>{};
+    state.definitions(begin, no_end, definitions, [&](const usize index) {
+        section_starts.push_back(
+                SectionStart{ index, definitions.size(), state.errors().size(), source.num_looked_at() }
+        );
+        first_reused = source.previous_section_at(index);
+        return first_reused.has_value();
+    });
+    if (not first_reused) {
+        section_starts.push_back(
+                SectionStart{ state.index(), definitions.size(), state.errors().size(), source.num_looked_at() }
+        );
+    }
+    // the parser errors may only be caused by the lexer error
+    if (source.error()) {
+        return Error<LexerError>{ *source.error() };
+    }
+
+    const auto errors = std::span{ state.errors() };
+    // a section depends on all tokens that the parser looked at until it reached the next section
+    const auto lookahead_end = [&](const SectionStart& next) {
+        assert(next.num_looked_at > next.index);
+        const auto last_token = source.at(next.num_looked_at - 1);
+        return last_token.offset() + last_token.length();
+    };
+    const auto arena = std::shared_ptr<Arena>{ state.arena_moved() };
+    const auto end_of_file = (first_reused ? edited_end_of_file(*previous, edit) : source.at(state.index()));
+    auto result = IncrementalProgram{ {}, end_of_file };
+    const auto num_reused = (first_reused ? previous->sections.size() - *first_reused : 0);
+    result.sections.reserve(restart + section_starts.size() + num_reused);
+    if (restart > 0) {
+        result.sections.insert(result.sections.end(), previous->sections.begin(), previous->sections.begin() + restart);
+    } else {
+        const auto num_errors = section_starts.front().num_errors;
+        result.sections.push_back(PlacedSection{
+                std::make_shared<const ProgramSection>(
+                        arena, arena->copy(source.tokens(0, begin)), lookahead_end(section_starts.front()), imports,
+                        nullptr,
+                        ParserErrors{ errors.begin(), errors.begin() + static_cast<std::ptrdiff_t>(num_errors) }
+                ),
+                0,
+        });
+    }
+    for (usize i = 0; i + 1 < section_starts.size(); ++i) {
+        const auto& start = section_starts[i];
+        const auto& end = section_starts[i + 1];
+        auto section_errors = ParserErrors{ errors.begin() + static_cast<std::ptrdiff_t>(start.num_errors),
+                                            errors.begin() + static_cast<std::ptrdiff_t>(end.num_errors) };
+        // without errors, a section consists of exactly one definition
+        assert(not section_errors.empty() or end.num_definitions == start.num_definitions + 1);
+        const auto definition = (section_errors.empty() ? definitions[start.num_definitions] : nullptr);
+        result.sections.push_back(PlacedSection{
+                std::make_shared<const ProgramSection>(
+                        arena, arena->copy(source.tokens(start.index, end.index)), lookahead_end(end),
+                        std::span<const ImportStatement>{}, definition, std::move(section_errors)
+                ),
+                0,
+        });
+    }
+    if (first_reused) {
+        assert(*first_reused > 0);
+        const auto shift = static_cast<i64>(edit.replacement_length) - static_cast<i64>(edit.length);
+        for (auto i = *first_reused; i < previous->sections.size(); ++i) {
+            const auto& placed = previous->sections[i];
+            result.sections.push_back(PlacedSection{ placed.section, placed.shift + shift });
+        }
+    }
+    return result;
+}
+
+[[nodiscard]] Result<IncrementalProgram, LexerError> parse_incrementally(const FileId file_id) {
+    const auto no_edit = TextEdit{ 0, 0, 0 };
+    auto source = EditedTokenSource{ file_id, 0, nullptr, no_edit };
+    return parse_sections(source, nullptr, 0, no_edit);
+}
+
+[[nodiscard]] Result<IncrementalProgram, LexerError> reparse(const IncrementalProgram& previous, const TextEdit& edit) {
+    const auto restart = restart_section(previous.sections, edit);
+    const auto& first_token = previous.sections[restart].section->tokens;
+    const auto offset = (restart == 0 ? 0 : previous.sections[restart].offset(first_token.front().offset()));
+    auto source = EditedTokenSource{ previous.end_of_file.file_id(), offset, &previous, edit };
+    return parse_sections(source, &previous, restart, edit);
 }
@@ -3,10 +3,15 @@
 #include "error_codes.hpp"
 #include "parser_nodes/parser_nodes.hpp"
 #include "source_location.hpp"
+#include "types.hpp"
+#include <memory>
+#include <span>
+#include <variant>
+#include <vector>
 
 struct ParserError final {
     ParserError(const Token& token, ErrorCode error_code, tl::optional<TokenType> expected = {})
-        : ParserError{ token.location, error_code, expected } { }
+        : ParserError{ token.location(), error_code, expected } { }
 
     ParserError(SourceLocation location, ErrorCode error_code, tl::optional<TokenType> expected = {})
         : location{ location },
@@ -20,4 +25,69 @@ struct ParserError final {
 
 using ParserErrors = std::vector<ParserError>;
 
-[[nodiscard]] tl::expected<parser_nodes::Program, ParserErrors> parse(TokenVector&& tokens);
+// after a lexer error, the parser errors are not reported, since the lexer error may have caused them
+using LexerOrParserErrors = std::variant<LexerError, ParserErrors>;
+
+struct ThreadPool;
+
+// the nodes hold copies of their tokens, so the tokens are not needed anymore afterwards
+[[nodiscard]] tl::expected<parser_nodes::Program, ParserErrors> parse(const TokenVector& tokens);
+
+// parses the top level definitions of large inputs in parallel, the result is the same as for a single thread
+[[nodiscard]] tl::expected<parser_nodes::Program, ParserErrors> parse(const TokenVector& tokens, ThreadPool& pool);
+
+// Lexes and parses at the same time: the parser asks the stream for every token and releases the tokens of every
+// top level definition it has parsed. So only the tokens of a single definition are in memory at a time, instead of
+// all tokens of the file. The result is the same as for tokenize() followed by parse().
+[[nodiscard]] tl::expected<parser_nodes::Program, LexerOrParserErrors> parse(TokenStream& tokens);
+
+// Lexes and parses at the same time in rounds: every round lexes some batches of top level definitions, which are
+// then parsed in parallel. So only the tokens of a single round are in memory at a time (unless errors make the parser
+// look further ahead), no matter how large the file is. The result is the same as for tokenize() followed by parse().
+[[nodiscard]] tl::expected<parser_nodes::Program, LexerOrParserErrors> parse(TokenStream& tokens, ThreadPool& pool);
+
+// One top level definition of a file that is parsed incrementally (or the tokens that failed to parse in its place),
+// along with its tokens and errors. The first section of a file holds its import statements instead. Sections never
+// change after parsing, so the versions of a file share all sections that an edit did not touch.
+struct ProgramSection final {
+    // owns the tokens and the nodes of all sections that have been parsed together
+    std::shared_ptr<const Arena> arena;
+    std::span<const Token> tokens;
+    // The end of the last token that the parser looked at while parsing the section, usually the first token of the
+    // next section. After errors, the parser may have looked further ahead than that.
+    usize lookahead_end;
+    std::span<const parser_nodes::ImportStatement> imports;
+    // only if there are no errors, never for the first section
+    const parser_nodes::Statement* definition;
+    ParserErrors errors;
+};
+
+// A section within a version of a file. The offsets within the section (of its tokens, nodes and errors) are the ones
+// of the version it has been parsed in, so they are shifted to get the offsets within this version.
+struct PlacedSection final {
+    std::shared_ptr<const ProgramSection> section;
+    i64 shift;
+
+    [[nodiscard]] usize offset(const usize offset) const {
+        return static_cast<usize>(static_cast<i64>(offset) + shift);
+    }
+};
+
+// The program of a file that is edited again and again, e.g. in an editor (see reparse()). An edit only replaces the
+// sections it touches and shifts the ones behind it, so unchanged definitions are shared with the previous version
+// instead of being copied.
+struct IncrementalProgram final {
+    std::vector<PlacedSection> sections;
+    // at its offset within the current version of the file
+    Token end_of_file;
+};
+
+// the same tokens, nodes and errors as tokenize() followed by parse(), split up into sections
+[[nodiscard]] Result<IncrementalProgram, LexerError> parse_incrementally(FileId file_id);
+
+// Parses the file of the previous program again after the edit has been applied to its source code (the file keeps
+// its FileId). Lexing and parsing restart at the first section for which the parser looked at a token that the edit
+// may have changed, since the sections in front of it stay the same. They stop at the first section behind the edit
+// that starts where a previous section started, once the lexer is back in sync with the previous tokens. The result
+// is the same as for parse_incrementally(), but all other sections are shared with the previous program.
+[[nodiscard]] Result<IncrementalProgram, LexerError> reparse(const IncrementalProgram& previous, const TextEdit& edit);
@@ -0,0 +1,63 @@
+#include "resident_modules.hpp"
+#include "hash.hpp"
+#include "source_buffer.hpp"
+#include <span>
+#include <utility>
+
+[[nodiscard]] Result<FileId, utils::IoError> ResidentModules::load_file(const std::filesystem::path& path) {
+    auto source_buffer = SourceBuffer::from_file(path);
+    if (not source_buffer) {
+        return Error<utils::IoError>{ source_buffer.error() };
+    }
+    const auto hash = hash_bytes(std::as_bytes(std::span{ source_buffer->view() }));
+
+    const auto lock = std::scoped_lock{ m_mutex };
+    auto filename = path.string();
+    const auto iterator = m_files.find(filename);
+    if (iterator != m_files.end() and iterator->second.hash == hash) {
+        return iterator->second.file_id;
+    }
+
+    const auto file_id = SourceFiles::add(filename, std::move(*source_buffer));
+    if (not file_id) {
+        return Error<utils::IoError>{ utils::IoError::TooManyFiles };
+    }
+    if (iterator != m_files.end()) {
+        // the previous contents (and their program) are only removed after this build has finished
+        m_replaced_files.push_back(iterator->second.file_id);
+        iterator->second = ResidentFile{ hash, *file_id, {} };
+    } else {
+        m_files.emplace(std::move(filename), ResidentFile{ hash, *file_id, {} });
+    }
+    return *file_id;
+}
+
+[[nodiscard]] Optional<parser_nodes::Program>
+ResidentModules::program(const std::filesystem::path& path, const FileId file_id) const {
+    const auto lock = std::scoped_lock{ m_mutex };
+    const auto iterator = m_files.find(path.string());
+    if (iterator == m_files.end() or iterator->second.file_id != file_id) {
+        return {};
+    }
+    return iterator->second.program;
+}
+
+void ResidentModules::store(
+        const std::filesystem::path& path,
+        const FileId file_id,
+        const parser_nodes::Program& program
+) {
+    const auto lock = std::scoped_lock{ m_mutex };
+    const auto iterator = m_files.find(path.string());
+    if (iterator != m_files.end() and iterator->second.file_id == file_id) {
+        iterator->second.program = program;
+    }
+}
+
+void ResidentModules::release_replaced_files() {
+    const auto lock = std::scoped_lock{ m_mutex };
+    for (const auto file_id : m_replaced_files) {
+        SourceFiles::remove(file_id);
+    }
+    m_replaced_files.clear();
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "parser_nodes/parser_nodes.hpp"
+#include "source_files.hpp"
+#include "types.hpp"
+#include "utils.hpp"
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Source files and syntax trees that are kept in memory between builds (by the compile server). A file is only
+// added to the SourceFiles table again if its contents have changed since it was last loaded. Otherwise it keeps
+// its file id, so its syntax tree (and every source location in it) stays valid and can be used as it is. The
+// previous contents of a changed file are removed from the SourceFiles table between builds.
+struct ResidentModules final {
+private:
+    struct ResidentFile final {
+        u64 hash;
+        FileId file_id;
+        Optional<parser_nodes::Program> program;
+    };
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, ResidentFile> m_files;
+    // previous contents of changed files, the build that loaded the new contents may still refer to them
+    std::vector<FileId> m_replaced_files;
+
+public:
+    // the file id of the current contents of the file
+    [[nodiscard]] Result<FileId, utils::IoError> load_file(const std::filesystem::path& path);
+
+    // returns nothing if the file has changed since the program was stored (or if there is none)
+    [[nodiscard]] Optional<parser_nodes::Program> program(const std::filesystem::path& path, FileId file_id) const;
+
+    void store(const std::filesystem::path& path, FileId file_id, const parser_nodes::Program& program);
+
+    // removes the previous contents of changed files, must only be called while no build is running
+    void release_replaced_files();
+};
@@ -0,0 +1,173 @@
+#include "simd.hpp"
+#include "utils.hpp"
+#include <bit>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SEATBELT_SIMD_AVX2
+#elif defined(__SSE2__) or defined(_M_X64) or (defined(_M_IX86_FP) and _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SEATBELT_SIMD_SSE2
+#endif
+
+namespace simd {
+
+    namespace {
+
+#if defined(SEATBELT_SIMD_AVX2)
+        using Block = __m256i;
+        constexpr usize block_size = 32;
+
+        [[nodiscard]] Block load(const char8_t* const data) {
+            return _mm256_loadu_si256(reinterpret_cast<const Block*>(data));
+        }
+
+        [[nodiscard]] Block broadcast(const char8_t c) {
+            return _mm256_set1_epi8(static_cast<char>(c));
+        }
+
+        [[nodiscard]] u32 equal_mask(const Block block, const char8_t c) {
+            return static_cast<u32>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, broadcast(c))));
+        }
+
+        // bytes in the (inclusive) range [first, last]
+        [[nodiscard]] u32 range_mask(const Block block, const char8_t first, const char8_t last) {
+            const auto shifted = _mm256_sub_epi8(block, broadcast(first));
+            const auto clamped = _mm256_min_epu8(shifted, broadcast(static_cast<char8_t>(last - first)));
+            return static_cast<u32>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(shifted, clamped)));
+        }
+
+        [[nodiscard]] u32 non_ascii_mask(const Block block) {
+            return static_cast<u32>(_mm256_movemask_epi8(block));
+        }
+
+        [[nodiscard]] u32 non_whitespace_mask(const Block block) {
+            const auto whitespace_mask = equal_mask(block, u8' ') | range_mask(block, u8'\t', u8'\r');
+            return ~whitespace_mask & u32{ 0xFFFF'FFFF };
+        }
+#elif defined(SEATBELT_SIMD_SSE2)
+        using Block = __m128i;
+        constexpr usize block_size = 16;
+
+        [[nodiscard]] Block load(const char8_t* const data) {
+            return _mm_loadu_si128(reinterpret_cast<const Block*>(data));
+        }
+
+        [[nodiscard]] Block broadcast(const char8_t c) {
+            return _mm_set1_epi8(static_cast<char>(c));
+        }
+
+        [[nodiscard]] u32 equal_mask(const Block block, const char8_t c) {
+            return static_cast<u32>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, broadcast(c))));
+        }
+
+        // bytes in the (inclusive) range [first, last]
+        [[nodiscard]] u32 range_mask(const Block block, const char8_t first, const char8_t last) {
+            const auto shifted = _mm_sub_epi8(block, broadcast(first));
+            const auto clamped = _mm_min_epu8(shifted, broadcast(static_cast<char8_t>(last - first)));
+            return static_cast<u32>(_mm_movemask_epi8(_mm_cmpeq_epi8(shifted, clamped)));
+        }
+
+        [[nodiscard]] u32 non_ascii_mask(const Block block) {
+            return static_cast<u32>(_mm_movemask_epi8(block));
+        }
+
+        [[nodiscard]] u32 non_whitespace_mask(const Block block) {
+            const auto whitespace_mask = equal_mask(block, u8' ') | range_mask(block, u8'\t', u8'\r');
+            return ~whitespace_mask & u32{ 0xFFFF };
+        }
+#endif
+
+        [[nodiscard]] constexpr bool is_whitespace(const char8_t c) {
+            return c == u8' ' or (c >= u8'\t' and c <= u8'\r');
+        }
+
+        // index of the first byte for which block_mask has its bit set (or byte_predicate returns true)
+        template<typename BlockMask, typename BytePredicate>
+        [[nodiscard]] usize
+        find_first(const std::u8string_view view, [[maybe_unused]] BlockMask block_mask, BytePredicate byte_predicate) {
+            auto index = usize{ 0 };
+#if defined(SEATBELT_SIMD_AVX2) or defined(SEATBELT_SIMD_SSE2)
+            while (index + block_size <= view.length()) {
+                const auto mask = block_mask(load(view.data() + index));
+                if (mask != 0) {
+                    return index + static_cast<usize>(std::countr_zero(mask));
+                }
+                index += block_size;
+            }
+#endif
+            // remaining bytes of the last partial block
+            while (index < view.length() and not byte_predicate(view[index])) {
+                ++index;
+            }
+            return index;
+        }
+
+    } // namespace
+
+    [[nodiscard]] usize ascii_prefix_length(const std::u8string_view view) {
+        return find_first(
+                view,
+                [](const auto block) { return non_ascii_mask(block); },
+                [](const char8_t c) { return c >= 0x80; }
+        );
+    }
+
+    [[nodiscard]] usize whitespace_prefix_length(const std::u8string_view view) {
+        return find_first(
+                view,
+                [](const auto block) { return non_whitespace_mask(block); },
+                [](const char8_t c) { return not is_whitespace(c); }
+        );
+    }
+
+    [[nodiscard]] usize find_newline(const std::u8string_view view) {
+        return find_first(
+                view,
+                [](const auto block) { return equal_mask(block, u8'\n'); },
+                [](const char8_t c) { return c == u8'\n'; }
+        );
+    }
+
+    [[nodiscard]] usize find_comment_delimiter(const std::u8string_view view) {
+        return find_first(
+                view,
+                [](const auto block) { return equal_mask(block, u8'*') | equal_mask(block, u8'/'); },
+                [](const char8_t c) { return c == u8'*' or c == u8'/'; }
+        );
+    }
+
+    [[nodiscard]] usize printable_ascii_count(const std::u8string_view view) {
+        auto result = usize{ 0 };
+        auto index = usize{ 0 };
+#if defined(SEATBELT_SIMD_AVX2) or defined(SEATBELT_SIMD_SSE2)
+        while (index + block_size <= view.length()) {
+            const auto mask = range_mask(load(view.data() + index), u8' ', u8'~');
+            result += static_cast<usize>(std::popcount(mask));
+            index += block_size;
+        }
+#endif
+        for (; index < view.length(); ++index) {
+            if (view[index] >= u8' ' and view[index] <= u8'~') {
+                ++result;
+            }
+        }
+        return result;
+    }
+
+    [[nodiscard]] usize valid_utf8_prefix_length(const std::u8string_view view) {
+        auto index = usize{ 0 };
+        while (true) {
+            index += ascii_prefix_length(view.substr(index));
+            if (index >= view.length()) {
+                return index;
+            }
+            const auto codepoint = utils::first_utf8_codepoint(view.substr(index));
+            if (not codepoint.has_value()) {
+                return index;
+            }
+            index += codepoint->length();
+        }
+    }
+
+} // namespace simd
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "types.hpp"
+#include <string_view>
+
+// scanning kernels for the lexer, vectorized with AVX2 or SSE2 if the target supports it
+namespace simd {
+
+    // all functions return the length of the view if no byte terminates the scan
+    [[nodiscard]] usize ascii_prefix_length(std::u8string_view view);
+    [[nodiscard]] usize whitespace_prefix_length(std::u8string_view view);
+    [[nodiscard]] usize find_newline(std::u8string_view view);
+    [[nodiscard]] usize find_comment_delimiter(std::u8string_view view); // '*' or '/'
+
+    // number of bytes in the range [0x20, 0x7E], i.e. the display width of an ASCII view
+    [[nodiscard]] usize printable_ascii_count(std::u8string_view view);
+
+    // ASCII runs are skipped in whole blocks, only non-ASCII bytes are decoded one codepoint at a time
+    [[nodiscard]] usize valid_utf8_prefix_length(std::u8string_view view);
+
+} // namespace simd
@@ -0,0 +1,118 @@
+#include "source_buffer.hpp"
+#include <algorithm>
+#include <fstream>
+#include <gsl/gsl>
+
+#if defined(__unix__) or defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SEATBELT_HAS_MMAP
+#endif
+
+void SourceBuffer::Unmapper::operator()([[maybe_unused]] char8_t* const address) const {
+#if defined(SEATBELT_HAS_MMAP)
+    ::munmap(address, mapping_size);
+#endif
+}
+
+[[nodiscard]] Result<SourceBuffer, utils::IoError> SourceBuffer::from_file(const std::filesystem::path& path) {
+    if (auto mapped = map_file(path)) {
+        return std::move(*mapped);
+    }
+    return read_file(path);
+}
+
+[[nodiscard]] SourceBuffer SourceBuffer::from_string(const std::u8string_view source_code) {
+    auto result = SourceBuffer{};
+    result.m_allocation = std::make_unique_for_overwrite<char8_t[]>(source_code.length() + 1);
+    std::ranges::copy(source_code, result.m_allocation.get());
+    result.m_allocation[source_code.length()] = u8'\n';
+    result.m_contents = std::u8string_view{ result.m_allocation.get(), source_code.length() + 1 };
+    return result;
+}
+
+// returns nothing if the file cannot be (or should not be) mapped, the caller then falls back to reading it
+[[nodiscard]] Optional<SourceBuffer> SourceBuffer::map_file([[maybe_unused]] const std::filesystem::path& path) {
+#if defined(SEATBELT_HAS_MMAP)
+    const auto file_descriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (file_descriptor == -1) {
+        return {};
+    }
+    const auto close_file = gsl::finally([&] { ::close(file_descriptor); });
+
+    struct stat file_status {};
+    if (::fstat(file_descriptor, &file_status) == -1 or not S_ISREG(file_status.st_mode)) {
+        return {};
+    }
+    const auto size = static_cast<usize>(file_status.st_size);
+    if (size < mmap_threshold) {
+        return {};
+    }
+
+    // There always is at least one byte of padding behind the file contents that holds the newline. It
+    // lies either in the zero-filled remainder of the last file page or in an additional anonymous page.
+    // Both are private to this process, so writing the newline only copies a single page.
+    const auto page_size = static_cast<usize>(::sysconf(_SC_PAGESIZE));
+    const auto mapping_size = (size / page_size + 1) * page_size;
+    const auto address = ::mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (address == MAP_FAILED) {
+        return {};
+    }
+    auto result = SourceBuffer{};
+    result.m_mapping = std::unique_ptr<char8_t, Unmapper>{ static_cast<char8_t*>(address), Unmapper{ mapping_size } };
+
+    // map the file over the start of the reserved range
+    if (::mmap(address, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, file_descriptor, 0) == MAP_FAILED) {
+        return {};
+    }
+    result.m_mapping.get()[size] = u8'\n';
+    ::mprotect(address, mapping_size, PROT_READ);
+
+    // the lexer reads the file front to back, so start reading ahead before the first page fault
+    ::madvise(address, size, MADV_SEQUENTIAL);
+    ::madvise(address, size, MADV_WILLNEED);
+
+    result.m_contents = std::u8string_view{ result.m_mapping.get(), size + 1 };
+    return result;
+#else
+    return {};
+#endif
+}
+
+[[nodiscard]] Result<SourceBuffer, utils::IoError> SourceBuffer::read_file(const std::filesystem::path& path) {
+    // open file with file cursor at the end, binary to not have windows newlines replaced
+    auto file = std::ifstream{ path, std::ios::in | std::ios::binary | std::ios::ate };
+    if (not file) {
+        return Error<utils::IoError>{ utils::IoError::CouldNotOpenFile };
+    }
+
+    // determine filesize
+    const auto tellg_result = file.tellg();
+    if (tellg_result == decltype(tellg_result){ -1 }) {
+        return Error<utils::IoError>{ utils::IoError::UnableToDetermineFileSize };
+    }
+    const auto size = gsl::narrow_cast<usize>(tellg_result);
+
+    // reset file cursor to the beginning
+    file.seekg(0, std::ios::beg);
+
+    // read contents of the file into an allocation that is not zero-filled first
+    auto result = SourceBuffer{};
+    result.m_allocation = std::make_unique_for_overwrite<char8_t[]>(size + 1);
+    try {
+        file.read(reinterpret_cast<char*>(result.m_allocation.get()), gsl::narrow_cast<std::streamsize>(size));
+    } catch (const std::ios::failure&) {
+        return Error<utils::IoError>{ utils::IoError::UnableToReadFile };
+    }
+    if (file.gcount() != gsl::narrow_cast<std::streamsize>(size)) {
+        return Error<utils::IoError>{ utils::IoError::UnableToReadFile };
+    }
+
+    // always end the contents with a newline
+    result.m_allocation[size] = u8'\n';
+
+    result.m_contents = std::u8string_view{ result.m_allocation.get(), size + 1 };
+    return result;
+}
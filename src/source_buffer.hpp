@@ -0,0 +1,41 @@
+#pragma once
+
+#include "types.hpp"
+#include "utils.hpp"
+#include <filesystem>
+#include <memory>
+#include <string_view>
+
+// Read-only contents of a source file that always end with an (additional) newline. Large files are
+// memory-mapped and the newline is written into the padding behind the mapped file instead of copying
+// the contents, small files (or platforms without mmap) are read into a single allocation.
+struct SourceBuffer final {
+private:
+    struct Unmapper final {
+        usize mapping_size;
+
+        void operator()(char8_t* address) const;
+    };
+
+    std::unique_ptr<char8_t[]> m_allocation;
+    std::unique_ptr<char8_t, Unmapper> m_mapping{ nullptr, Unmapper{ 0 } };
+    std::u8string_view m_contents;
+
+    SourceBuffer() = default;
+
+    [[nodiscard]] static Optional<SourceBuffer> map_file(const std::filesystem::path& path);
+    [[nodiscard]] static Result<SourceBuffer, utils::IoError> read_file(const std::filesystem::path& path);
+
+public:
+    // files smaller than this are cheaper to read than to map
+    static constexpr usize mmap_threshold = 64 * 1024;
+
+    [[nodiscard]] static Result<SourceBuffer, utils::IoError> from_file(const std::filesystem::path& path);
+
+    // copies source code that does not come from a file (e.g. generated code)
+    [[nodiscard]] static SourceBuffer from_string(std::u8string_view source_code);
+
+    [[nodiscard]] std::u8string_view view() const {
+        return m_contents;
+    }
+};
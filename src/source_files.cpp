@@ -0,0 +1,100 @@
+#include "source_files.hpp"
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// owns its file, lookups read it without taking the lock
+struct FileSlot final {
+    std::atomic<SourceFile*> file{ nullptr };
+
+    FileSlot() = default;
+    FileSlot(const FileSlot&) = delete;
+    FileSlot& operator=(const FileSlot&) = delete;
+
+    ~FileSlot() {
+        delete file.load(std::memory_order_relaxed);
+    }
+
+    // publishes the new file, the previous one is returned so it can be freed outside of the lock
+    [[nodiscard]] std::unique_ptr<SourceFile> exchange(std::unique_ptr<SourceFile> new_file) {
+        return std::unique_ptr<SourceFile>{ file.exchange(new_file.release(), std::memory_order_acq_rel) };
+    }
+};
+
+static std::mutex files_mutex;
+static std::array<FileSlot, SourceFiles::max_num_files> files;
+// entries that have been used so far, removed entries in between are reused first
+static usize num_files = 0;
+static std::vector<FileId> removed_file_ids;
+
+SourceFile::SourceFile(std::string filename, SourceBuffer source_code)
+    : m_filename{ std::move(filename) },
+      m_source_code{ std::move(source_code) },
+      m_line_table{ m_source_code.view() } { }
+
+[[nodiscard]] Optional<FileId> SourceFiles::add(std::string filename, SourceBuffer source_code) {
+    auto file = std::make_unique<SourceFile>(std::move(filename), std::move(source_code));
+
+    const auto lock = std::scoped_lock{ files_mutex };
+    if (not removed_file_ids.empty()) {
+        const auto file_id = removed_file_ids.back();
+        removed_file_ids.pop_back();
+        std::ignore = files[std::to_underlying(file_id)].exchange(std::move(file));
+        return file_id;
+    }
+    if (num_files == max_num_files) {
+        return {};
+    }
+    const auto file_id = FileId{ static_cast<u16>(num_files) };
+    std::ignore = files[num_files].exchange(std::move(file));
+    ++num_files;
+    return file_id;
+}
+
+[[nodiscard]] Result<FileId, utils::IoError> SourceFiles::load(const std::filesystem::path& path) {
+    auto source_buffer = SourceBuffer::from_file(path);
+    if (not source_buffer) {
+        return Error<utils::IoError>{ source_buffer.error() };
+    }
+    const auto file_id = add(path.string(), std::move(*source_buffer));
+    if (not file_id) {
+        return Error<utils::IoError>{ utils::IoError::TooManyFiles };
+    }
+    return *file_id;
+}
+
+[[nodiscard]] const SourceFile& SourceFiles::get(const FileId file_id) {
+    const auto index = std::to_underlying(file_id);
+    assert(index < max_num_files);
+    const auto file = files[index].file.load(std::memory_order_acquire);
+    assert(file != nullptr);
+    return *file;
+}
+
+void SourceFiles::replace(const FileId file_id, SourceBuffer source_code) {
+    const auto index = std::to_underlying(file_id);
+    auto file = std::make_unique<SourceFile>(std::string{ get(file_id).filename() }, std::move(source_code));
+    {
+        const auto lock = std::scoped_lock{ files_mutex };
+        assert(index < num_files and files[index].file.load(std::memory_order_relaxed) != nullptr);
+        file = files[index].exchange(std::move(file));
+    }
+    // the previous contents are freed outside of the lock
+}
+
+void SourceFiles::remove(const FileId file_id) {
+    const auto index = std::to_underlying(file_id);
+    auto file = std::unique_ptr<SourceFile>{};
+    {
+        const auto lock = std::scoped_lock{ files_mutex };
+        assert(index < num_files and files[index].file.load(std::memory_order_relaxed) != nullptr);
+        file = files[index].exchange(nullptr);
+        removed_file_ids.push_back(file_id);
+    }
+    // the contents are freed outside of the lock
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "line_table.hpp"
+#include "source_buffer.hpp"
+#include "types.hpp"
+#include "utils.hpp"
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+enum class FileId : u16 {};
+
+// owns the contents of a single source file and its line table
+struct SourceFile final {
+private:
+    std::string m_filename;
+    SourceBuffer m_source_code;
+    LineTable m_line_table;
+
+public:
+    SourceFile(std::string filename, SourceBuffer source_code);
+
+    // the line table points into the source code, so source files must stay in place
+    SourceFile(const SourceFile&) = delete;
+    SourceFile& operator=(const SourceFile&) = delete;
+
+    [[nodiscard]] std::string_view filename() const {
+        return m_filename;
+    }
+
+    [[nodiscard]] std::u8string_view source_code() const {
+        return m_source_code.view();
+    }
+
+    [[nodiscard]] const LineTable& line_table() const {
+        return m_line_table;
+    }
+};
+
+// Process-wide table of all loaded source files. Tokens and source locations only store a FileId
+// and resolve filenames, lexemes and line numbers through this table. Adding, replacing and removing
+// files is thread-safe, looking them up does not lock (the entries are published atomically).
+// Long-running processes replace or remove files they don't need anymore, so their FileIds can be
+// reused. Only the owner of a file may do so, once no other thread refers to its contents anymore.
+struct SourceFiles final {
+    static constexpr usize file_id_bits = 12;
+    static constexpr usize max_num_files = usize{ 1 } << file_id_bits;
+
+    SourceFiles() = delete;
+
+    // returns nothing if there are max_num_files files at the same time
+    [[nodiscard]] static Optional<FileId> add(std::string filename, SourceBuffer source_code);
+    // reads the file and adds it
+    [[nodiscard]] static Result<FileId, utils::IoError> load(const std::filesystem::path& path);
+    [[nodiscard]] static const SourceFile& get(FileId file_id);
+    // the file keeps its FileId, tokens and locations within the previous contents must not be resolved anymore
+    static void replace(FileId file_id, SourceBuffer source_code);
+    // frees (or unmaps) the contents of the file, its FileId may be handed out again
+    static void remove(FileId file_id);
+};
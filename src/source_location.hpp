@@ -1,5 +1,6 @@
 #pragma once
 
+#include "source_files.hpp"
 #include "types.hpp"
 #include "utils.hpp"
 #include <cassert>
@@ -10,28 +11,44 @@
 
 struct SourceLocation final {
 private:
-    std::string_view m_filename;
-
-private:
-    std::u8string_view m_source_code;
-    std::u8string_view m_lexeme;
+    FileId m_file_id;
+    u32 m_offset;
+    u32 m_length;
 
 public:
-    SourceLocation(std::string_view filename, std::u8string_view source_code, std::u8string_view lexeme)
-        : m_filename{ filename },
-          m_source_code{ source_code },
-          m_lexeme{ lexeme } { }
+    SourceLocation(const FileId file_id, const usize offset, const usize length)
+        : m_file_id{ file_id },
+          m_offset{ static_cast<u32>(offset) },
+          m_length{ static_cast<u32>(length) } {
+        assert(offset + length <= source_file().source_code().length());
+    }
+
+    [[nodiscard]] auto file_id() const {
+        return m_file_id;
+    }
+
+    [[nodiscard]] usize offset() const {
+        return m_offset;
+    }
+
+    [[nodiscard]] usize length() const {
+        return m_length;
+    }
+
+    [[nodiscard]] const SourceFile& source_file() const {
+        return SourceFiles::get(m_file_id);
+    }
 
     [[nodiscard]] auto filename() const {
-        return m_filename;
+        return source_file().filename();
     }
 
     [[nodiscard]] auto source_code() const {
-        return m_source_code;
+        return source_file().source_code();
     }
 
     [[nodiscard]] auto lexeme() const {
-        return m_lexeme;
+        return source_code().substr(m_offset, m_length);
     }
 
     [[nodiscard]] auto ascii_lexeme() const {
@@ -39,28 +56,10 @@ public:
     }
 
     [[nodiscard]] usize line_number() const {
-        assert(std::greater_equal{}(m_lexeme.data(), m_source_code.data()));
-        assert(std::less_equal{}(m_lexeme.data() + m_lexeme.length(), m_source_code.data() + m_source_code.length()));
-        auto result = usize{ 1 };
-        for (auto current = m_source_code.data(); current != m_lexeme.data(); ++current) {
-            if (*current == '\n') {
-                ++result;
-            }
-        }
-        return result;
+        return source_file().line_table().line_number(offset());
     }
 
     [[nodiscard]] usize column_number() const {
-        assert(std::greater_equal{}(m_lexeme.data(), m_source_code.data()));
-        assert(std::less_equal{}(m_lexeme.data() + m_lexeme.length(), m_source_code.data() + m_source_code.length()));
-        const auto up_until_lexeme = m_source_code.substr(
-                0, static_cast<decltype(m_source_code)::size_type>(m_lexeme.data() - m_source_code.data())
-        );
-        const auto newline_index = up_until_lexeme.rfind('\n');
-        const auto found = (newline_index != decltype(up_until_lexeme)::npos);
-        const auto line_start = (found ? m_source_code.data() + newline_index + 1 : m_source_code.data());
-        const auto line_until_lexeme = std::u8string_view{ line_start, m_lexeme.data() };
-
-        return utils::utf8_width(line_until_lexeme).value() + 1;
+        return source_file().line_table().column_number(offset());
     }
 };
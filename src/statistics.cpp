@@ -0,0 +1,286 @@
+#include "statistics.hpp"
+#include "json.hpp"
+#include "memory_usage.hpp"
+#include <algorithm>
+#include <array>
+#include <fmt/format.h>
+#include <string_view>
+
+#if defined(__unix__) or defined(__APPLE__)
+#include <time.h>
+#endif
+
+using namespace parser_nodes;
+
+struct PhaseName final {
+    Phase phase;
+    std::string_view name;
+    std::string_view item_name;
+};
+
+static constexpr auto phase_names = std::array{
+    PhaseName{        Phase::ReadFile,        "read file",        ""},
+    PhaseName{   Phase::LoadFromCache,  "load from cache",   "nodes"},
+    PhaseName{        Phase::Tokenize,         "tokenize",  "tokens"},
+    PhaseName{           Phase::Parse,            "parse",   "nodes"},
+    PhaseName{Phase::TokenizeAndParse, "tokenize + parse",   "nodes"},
+    PhaseName{    Phase::StoreInCache,   "store in cache",        ""},
+    PhaseName{  Phase::ResolveImports,  "resolve imports", "imports"},
+};
+
+// every phase is listed once, in the order of the report
+[[nodiscard]] static usize phase_index(const Phase phase) {
+    return static_cast<usize>(std::ranges::find(phase_names, phase, &PhaseName::phase) - phase_names.begin());
+}
+
+// only the time of the calling thread, so phases running in parallel are measured separately
+[[nodiscard]] static Optional<std::chrono::nanoseconds> thread_cpu_time() {
+#if defined(__unix__) or defined(__APPLE__)
+    auto time = timespec{};
+    if (::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) != 0) {
+        return {};
+    }
+    return std::chrono::seconds{ time.tv_sec } + std::chrono::nanoseconds{ time.tv_nsec };
+#else
+    return {};
+#endif
+}
+
+[[nodiscard]] static double to_milliseconds(const std::chrono::nanoseconds duration) {
+    return std::chrono::duration<double, std::milli>{ duration }.count();
+}
+
+[[nodiscard]] static double to_microseconds(const std::chrono::nanoseconds duration) {
+    return std::chrono::duration<double, std::micro>{ duration }.count();
+}
+
+[[nodiscard]] static std::string to_mebibytes(const Optional<usize> bytes) {
+    if (not bytes) {
+        return "unknown";
+    }
+    return fmt::format("{:.1f} MiB", static_cast<double>(*bytes) / (1024.0 * 1024.0));
+}
+
+[[nodiscard]] static std::string json_string(const std::string_view string) {
+    auto result = std::string{};
+    append_json_string(result, string);
+    return result;
+}
+
+[[nodiscard]] static usize count_nodes(std::span<const Statement* const> statements);
+
+[[nodiscard]] static usize count_nodes(const FunctionDefinition& definition) {
+    // the definition, its parameter list and its body
+    auto result = usize{ 3 };
+    if (definition.type_parameters) {
+        ++result;
+    }
+    // every parameter and the name of its type
+    result += 2 * definition.parameters.parameters.size();
+    if (definition.return_type) {
+        // the return type and its name
+        result += 2;
+    }
+    return result + count_nodes(definition.body.statements);
+}
+
+[[nodiscard]] static usize count_nodes(const std::span<const Statement* const> statements) {
+    auto result = usize{ 0 };
+    for (const auto statement : statements) {
+        result += count_nodes(dynamic_cast<const FunctionDefinition&>(*statement));
+    }
+    return result;
+}
+
+[[nodiscard]] usize count_nodes(const Program& program) {
+    // the program, and every import and its module name
+    return 1 + 2 * program.imports.size() + count_nodes(program.statements);
+}
+
+void Statistics::record(PhaseRecord record) {
+    const auto lock = std::scoped_lock{ m_mutex };
+    m_records.push_back(std::move(record));
+}
+
+[[nodiscard]] std::string Statistics::time_report() const {
+    struct PhaseTotal final {
+        usize num_files{ 0 };
+        std::chrono::nanoseconds wall_time{ 0 };
+        Optional<std::chrono::nanoseconds> cpu_time{ std::chrono::nanoseconds{ 0 } };
+        PhaseCounts counts;
+    };
+
+    auto totals = std::array<PhaseTotal, phase_names.size()>{};
+    {
+        const auto lock = std::scoped_lock{ m_mutex };
+        for (const auto& record : m_records) {
+            auto& total = totals[phase_index(record.phase)];
+            ++total.num_files;
+            total.wall_time += record.wall_time;
+            total.cpu_time = (total.cpu_time and record.cpu_time ? *total.cpu_time + *record.cpu_time
+                                                                   : Optional<std::chrono::nanoseconds>{});
+            total.counts.num_items += record.counts.num_items;
+            total.counts.num_bytes += record.counts.num_bytes;
+        }
+    }
+
+    auto result = fmt::format(
+            "{:<18}{:>8}{:>14}{:>14}{:>20}{:>16}\n", "phase", "files", "wall time", "cpu time", "produced", "allocated"
+    );
+    for (usize i = 0; i < phase_names.size(); ++i) {
+        const auto& [phase, name, item_name] = phase_names[i];
+        const auto& total = totals[i];
+        if (total.num_files == 0) {
+            continue;
+        }
+        const auto cpu_time = (total.cpu_time ? fmt::format("{:.3f} ms", to_milliseconds(*total.cpu_time)) : "-");
+        const auto produced = (item_name.empty() ? "-" : fmt::format("{} {}", total.counts.num_items, item_name));
+        result += fmt::format(
+                "{:<18}{:>8}{:>11.3f} ms{:>14}{:>20}{:>10} bytes\n", name, total.num_files,
+                to_milliseconds(total.wall_time), cpu_time, produced, total.counts.num_bytes
+        );
+    }
+    // the phases of different files overlap, so the sum of their times can exceed the elapsed time
+    result += fmt::format(
+            "elapsed: {:.3f} ms, peak memory usage: {}\n",
+            to_milliseconds(std::chrono::steady_clock::now() - m_start), to_mebibytes(peak_rss())
+    );
+    return result;
+}
+
+[[nodiscard]] std::string Statistics::summary() const {
+    auto num_files = usize{ 0 };
+    auto num_tokens = usize{ 0 };
+    auto num_nodes = usize{ 0 };
+    auto num_bytes = usize{ 0 };
+    {
+        const auto lock = std::scoped_lock{ m_mutex };
+        for (const auto& record : m_records) {
+            switch (record.phase) {
+                case Phase::ReadFile:
+                    ++num_files;
+                    break;
+                case Phase::Tokenize:
+                    num_tokens += record.counts.num_items;
+                    break;
+                case Phase::LoadFromCache:
+                case Phase::Parse:
+                case Phase::TokenizeAndParse:
+                    num_nodes += record.counts.num_items;
+                    break;
+                case Phase::StoreInCache:
+                case Phase::ResolveImports:
+                    break;
+            }
+            num_bytes += record.counts.num_bytes;
+        }
+    }
+    return fmt::format(
+            "files: {}\ntokens: {}\nnodes: {}\nallocated: {} bytes\npeak memory usage: {}\n", num_files, num_tokens,
+            num_nodes, num_bytes, to_mebibytes(peak_rss())
+    );
+}
+
+void LatencyHistogram::record(const std::chrono::nanoseconds latency) {
+    // bucket i counts the latencies below 2^i microseconds, the last one all others
+    auto bucket = usize{ 0 };
+    const auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+    while (bucket + 1 < num_buckets and (decltype(microseconds){ 1 } << bucket) <= microseconds) {
+        ++bucket;
+    }
+    ++m_buckets[bucket];
+    ++m_count;
+    m_total += latency;
+    m_max = std::max(m_max, latency);
+}
+
+[[nodiscard]] std::string LatencyHistogram::to_string() const {
+    if (m_count == 0) {
+        return "count: 0\n";
+    }
+    auto result = fmt::format(
+            "count: {}, mean: {:.3f} ms, max: {:.3f} ms\n", m_count,
+            to_milliseconds(m_total / static_cast<std::chrono::nanoseconds::rep>(m_count)), to_milliseconds(m_max)
+    );
+    const auto first = std::ranges::find_if(m_buckets, [](const usize count) { return count > 0; });
+    const auto last = std::ranges::find_if(m_buckets.rbegin(), m_buckets.rend(), [](const usize count) {
+                          return count > 0;
+                      }).base();
+    for (auto bucket = first; bucket != last; ++bucket) {
+        const auto index = static_cast<usize>(bucket - m_buckets.begin());
+        const auto upper_bound = to_milliseconds(std::chrono::microseconds{ i64{ 1 } << index });
+        const auto label = (index + 1 == num_buckets ? std::string{ "more" } : fmt::format("< {:.3f} ms", upper_bound));
+        result += fmt::format(
+                "  {:>14}: {:>6} {}\n", label, *bucket, std::string(*bucket * 40 / m_count, '#')
+        );
+    }
+    return result;
+}
+
+[[nodiscard]] std::string Statistics::chrome_trace() const {
+    const auto lock = std::scoped_lock{ m_mutex };
+
+    // threads are numbered in the order of their first phase
+    auto threads = std::vector<std::thread::id>{};
+    const auto thread_index = [&](const std::thread::id id) {
+        const auto iterator = std::ranges::find(threads, id);
+        if (iterator != threads.end()) {
+            return static_cast<usize>(iterator - threads.begin());
+        }
+        threads.push_back(id);
+        return threads.size() - 1;
+    };
+
+    auto result = std::string{ "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [" };
+    auto separator = "";
+    for (const auto& record : m_records) {
+        const auto& [phase, name, item_name] = phase_names[phase_index(record.phase)];
+        auto arguments =
+                fmt::format("\"file\": {}, \"bytes\": {}", json_string(record.filename), record.counts.num_bytes);
+        if (not item_name.empty()) {
+            arguments += fmt::format(", \"{}\": {}", item_name, record.counts.num_items);
+        }
+        if (record.cpu_time) {
+            arguments += fmt::format(", \"cpu_ms\": {:.3f}", to_milliseconds(*record.cpu_time));
+        }
+        result += fmt::format(
+                "{}\n  {{\"name\": {}, \"cat\": \"phase\", \"ph\": \"X\", \"pid\": 1, \"tid\": {}, \"ts\": {:.3f}, "
+                "\"dur\": {:.3f}, \"args\": {{{}}}}}",
+                separator, json_string(name), thread_index(record.thread_id), to_microseconds(record.start),
+                to_microseconds(record.wall_time), arguments
+        );
+        separator = ",";
+    }
+    return result + "\n]}\n";
+}
+
+void PhaseTimer::begin() {
+    m_running = true;
+    m_start_cpu_time = thread_cpu_time();
+    m_start = std::chrono::steady_clock::now();
+}
+
+void PhaseTimer::end() {
+    if (not m_running) {
+        return;
+    }
+    m_running = false;
+    m_end = std::chrono::steady_clock::now();
+    const auto end_cpu_time = thread_cpu_time();
+    if (m_start_cpu_time and end_cpu_time) {
+        m_cpu_time = *end_cpu_time - *m_start_cpu_time;
+    }
+}
+
+void PhaseTimer::commit() {
+    end();
+    m_statistics->record(PhaseRecord{
+            .phase = m_phase,
+            .filename = m_path.string(),
+            .thread_id = std::this_thread::get_id(),
+            .start = m_start - m_statistics->start(),
+            .wall_time = m_end - m_start,
+            .cpu_time = m_cpu_time,
+            .counts = m_counts,
+    });
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "parser_nodes/parser_nodes.hpp"
+#include "types.hpp"
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class Phase {
+    ReadFile,
+    LoadFromCache,
+    Tokenize,
+    Parse,
+    // for modules whose tokens are streamed into the parser
+    TokenizeAndParse,
+    StoreInCache,
+    ResolveImports,
+};
+
+// what has been produced in a phase, e.g. the tokens and the memory they take up
+struct PhaseCounts final {
+    usize num_items{ 0 };
+    usize num_bytes{ 0 };
+};
+
+struct PhaseRecord final {
+    Phase phase;
+    std::string filename;
+    std::thread::id thread_id;
+    std::chrono::nanoseconds start; // relative to the start of the build
+    std::chrono::nanoseconds wall_time;
+    Optional<std::chrono::nanoseconds> cpu_time;
+    PhaseCounts counts;
+};
+
+// includes the program itself
+[[nodiscard]] usize count_nodes(const parser_nodes::Program& program);
+
+// Collects the phases of every file of a build, from all threads. The report lists the totals per phase, the
+// trace lists every single phase as a Chrome trace event (to be viewed in chrome://tracing or Perfetto).
+struct Statistics final {
+private:
+    std::chrono::steady_clock::time_point m_start{ std::chrono::steady_clock::now() };
+    mutable std::mutex m_mutex;
+    std::vector<PhaseRecord> m_records;
+
+public:
+    [[nodiscard]] std::chrono::steady_clock::time_point start() const {
+        return m_start;
+    }
+
+    void record(PhaseRecord record);
+
+    [[nodiscard]] std::string time_report() const;
+    [[nodiscard]] std::string summary() const;
+    [[nodiscard]] std::string chrome_trace() const;
+};
+
+// Counts durations (e.g. of the requests to the language server) in buckets whose upper bounds double, starting at
+// one microsecond. Not thread-safe.
+struct LatencyHistogram final {
+private:
+    static constexpr usize num_buckets = 32;
+
+    std::array<usize, num_buckets> m_buckets{};
+    usize m_count{ 0 };
+    std::chrono::nanoseconds m_total{};
+    std::chrono::nanoseconds m_max{};
+
+public:
+    void record(std::chrono::nanoseconds latency);
+
+    [[nodiscard]] usize count() const {
+        return m_count;
+    }
+
+    // one line with count, mean and maximum, followed by one line per bucket from the first to the last non-empty one
+    [[nodiscard]] std::string to_string() const;
+};
+
+// Measures a single phase of a single file. Without statistics it does nothing at all (not even reading the
+// clock), so the phases can always be measured.
+struct PhaseTimer final {
+private:
+    Statistics* m_statistics;
+    Phase m_phase;
+    const std::filesystem::path& m_path;
+    std::chrono::steady_clock::time_point m_start{};
+    std::chrono::steady_clock::time_point m_end{};
+    Optional<std::chrono::nanoseconds> m_start_cpu_time{};
+    Optional<std::chrono::nanoseconds> m_cpu_time{};
+    PhaseCounts m_counts{};
+    bool m_running{ false };
+
+    void begin();
+    void end();
+    void commit();
+
+public:
+    PhaseTimer(Statistics* const statistics, const Phase phase, const std::filesystem::path& path)
+        : m_statistics{ statistics },
+          m_phase{ phase },
+          m_path{ path } {
+        if (m_statistics != nullptr) {
+            begin();
+        }
+    }
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+    // phases that are left early (e.g. because of an error) are recorded as well
+    ~PhaseTimer() {
+        if (m_statistics != nullptr) {
+            commit();
+        }
+    }
+
+    void stop() {
+        if (m_statistics != nullptr) {
+            end();
+        }
+    }
+
+    // the counts are only determined with statistics, after the phase has ended
+    template<typename CountFunction>
+    void stop(CountFunction count) {
+        if (m_statistics != nullptr) {
+            end();
+            m_counts = count();
+        }
+    }
+};
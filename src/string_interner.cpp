@@ -0,0 +1,84 @@
+#include "string_interner.hpp"
+#include "arena.hpp"
+#include <array>
+#include <bit>
+#include <cassert>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <utility>
+
+// strings are distributed over the shards by their hash, so threads interning different strings rarely wait
+static constexpr usize shard_bits = 6;
+static constexpr usize num_shards = usize{ 1 } << shard_bits;
+static constexpr usize max_num_strings_per_shard = usize{ 1 } << (32 - shard_bits);
+
+// the strings of a shard are listed in chunks that double in size, so existing entries never move
+static constexpr usize first_chunk_size = 256;
+static constexpr usize max_num_chunks = 32 - shard_bits - std::countr_zero(first_chunk_size) + 1;
+
+struct Shard final {
+    std::mutex mutex;
+    Arena strings;
+    std::unordered_map<std::u8string_view, Symbol> symbols;
+    std::array<std::unique_ptr<std::u8string_view[]>, max_num_chunks> chunks;
+    usize num_strings{ 0 };
+};
+
+static std::array<Shard, num_shards> shards;
+
+// Identifiers repeat a lot, so every thread remembers the strings it has recently interned and only has to lock
+// a shard for strings it has not seen in a while. The remembered strings point into the shards.
+struct RecentString final {
+    std::u8string_view string;
+    Symbol symbol;
+};
+
+static thread_local std::array<RecentString, 512> recent_strings;
+
+[[nodiscard]] static std::pair<usize, usize> chunk_and_offset(const usize index) {
+    const auto chunk = static_cast<usize>(std::bit_width(index / first_chunk_size + 1)) - 1;
+    return { chunk, index - first_chunk_size * ((usize{ 1 } << chunk) - 1) };
+}
+
+[[nodiscard]] Symbol StringInterner::intern(const std::u8string_view string) {
+    const auto hash = std::hash<std::u8string_view>{}(string);
+    auto& recent = recent_strings[(hash >> shard_bits) % recent_strings.size()];
+    if (recent.string.data() != nullptr and recent.string == string) {
+        return recent.symbol;
+    }
+
+    const auto shard_index = hash % num_shards;
+    auto& shard = shards[shard_index];
+    const auto lock = std::scoped_lock{ shard.mutex };
+    if (const auto iterator = shard.symbols.find(string); iterator != shard.symbols.end()) {
+        recent = RecentString{ iterator->first, iterator->second };
+        return iterator->second;
+    }
+
+    const auto index = shard.num_strings;
+    assert(index < max_num_strings_per_shard);
+    const auto [chunk, offset] = chunk_and_offset(index);
+    if (shard.chunks[chunk] == nullptr) {
+        shard.chunks[chunk] = std::make_unique<std::u8string_view[]>(first_chunk_size << chunk);
+    }
+    const auto stored = shard.strings.copy(std::span{ string });
+    const auto interned = std::u8string_view{ stored.data(), stored.size() };
+    shard.chunks[chunk][offset] = interned;
+    ++shard.num_strings;
+
+    const auto symbol = Symbol{ static_cast<u32>(index << shard_bits | shard_index) };
+    shard.symbols.emplace(interned, symbol);
+    recent = RecentString{ interned, symbol };
+    return symbol;
+}
+
+[[nodiscard]] std::u8string_view StringInterner::view(const Symbol symbol) {
+    const auto value = usize{ std::to_underlying(symbol) };
+    const auto& shard = shards[value % num_shards];
+    const auto [chunk, offset] = chunk_and_offset(value >> shard_bits);
+    assert(chunk < max_num_chunks and shard.chunks[chunk] != nullptr);
+    return shard.chunks[chunk][offset];
+}
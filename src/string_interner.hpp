@@ -0,0 +1,17 @@
+#pragma once
+
+#include "types.hpp"
+#include <string_view>
+
+enum class Symbol : u32 {};
+
+// Process-wide table of interned strings (e.g. identifiers). Equal strings are always interned as the same
+// symbol, so later stages compare and hash symbols instead of strings. Interning is thread-safe, looking up the
+// string of a symbol does not lock (a symbol is only handed out after its string has been stored and strings are
+// never removed).
+struct StringInterner final {
+    StringInterner() = delete;
+
+    [[nodiscard]] static Symbol intern(std::u8string_view string);
+    [[nodiscard]] static std::u8string_view view(Symbol symbol);
+};
@@ -0,0 +1,83 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+
+// identifies the worker that runs on the current thread
+static thread_local const ThreadPool* current_pool = nullptr;
+static thread_local usize current_worker_index = 0;
+
+ThreadPool::ThreadPool(const usize num_threads) {
+    const auto actual_num_threads =
+            (num_threads > 0 ? num_threads : std::max(usize{ 1 }, usize{ std::thread::hardware_concurrency() }));
+    for (usize i = 0; i < actual_num_threads + 1; ++i) {
+        m_queues.push_back(std::make_unique<TaskQueue>());
+    }
+    m_workers.reserve(actual_num_threads);
+    for (usize i = 0; i < actual_num_threads; ++i) {
+        m_workers.emplace_back([this, i]() { work(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        const auto lock = std::scoped_lock{ m_mutex };
+        m_stopping = true;
+    }
+    m_tasks_available.notify_all();
+    // the workers finish all queued tasks and are joined by the destructors of the std::jthread objects
+}
+
+void ThreadPool::work(const usize worker_index) {
+    current_pool = this;
+    current_worker_index = worker_index;
+    while (true) {
+        if (auto task = take_task(worker_index)) {
+            task();
+            continue;
+        }
+        auto lock = std::unique_lock{ m_mutex };
+        m_tasks_available.wait(lock, [&]() { return m_stopping or m_num_queued_tasks > 0; });
+        if (m_stopping and m_num_queued_tasks == 0) {
+            return;
+        }
+    }
+}
+
+// returns an empty function if there are no tasks left
+[[nodiscard]] std::function<void()> ThreadPool::take_task(const usize queue_index) {
+    {
+        auto& own_queue = *m_queues[queue_index];
+        const auto lock = std::scoped_lock{ own_queue.mutex };
+        if (not own_queue.tasks.empty()) {
+            auto task = std::move(own_queue.tasks.back());
+            own_queue.tasks.pop_back();
+            --m_num_queued_tasks;
+            return task;
+        }
+    }
+    for (usize offset = 1; offset < m_queues.size(); ++offset) {
+        auto& other_queue = *m_queues[(queue_index + offset) % m_queues.size()];
+        const auto lock = std::scoped_lock{ other_queue.mutex };
+        if (not other_queue.tasks.empty()) {
+            auto task = std::move(other_queue.tasks.front());
+            other_queue.tasks.pop_front();
+            --m_num_queued_tasks;
+            return task;
+        }
+    }
+    return {};
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    const auto queue_index = (current_pool == this ? current_worker_index : m_queues.size() - 1);
+    {
+        auto& queue = *m_queues[queue_index];
+        const auto lock = std::scoped_lock{ queue.mutex };
+        queue.tasks.push_back(std::move(task));
+        ++m_num_queued_tasks;
+    }
+    {
+        // a worker that is about to wait either sees the new task or gets notified
+        const auto lock = std::scoped_lock{ m_mutex };
+    }
+    m_tasks_available.notify_one();
+}
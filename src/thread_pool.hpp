@@ -0,0 +1,81 @@
+#pragma once
+
+#include "types.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool. Every worker has its own queue: tasks that are submitted by a task go to the
+// queue of the worker running it, which takes the most recently submitted task first. Workers without
+// tasks of their own take the oldest task from the queue of another worker (or from the queue of tasks
+// that were submitted from outside of the pool).
+struct ThreadPool final {
+private:
+    struct TaskQueue final {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    // one queue per worker, followed by the queue for tasks from outside of the pool
+    std::vector<std::unique_ptr<TaskQueue>> m_queues;
+    std::atomic<usize> m_num_queued_tasks{ 0 };
+    std::mutex m_mutex;
+    std::condition_variable m_tasks_available;
+    bool m_stopping{ false };
+    std::vector<std::jthread> m_workers;
+
+    void work(usize worker_index);
+    [[nodiscard]] std::function<void()> take_task(usize queue_index);
+
+public:
+    // a value of zero uses one thread per hardware thread
+    explicit ThreadPool(usize num_threads = 0);
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ~ThreadPool();
+
+    [[nodiscard]] usize num_threads() const {
+        return m_workers.size();
+    }
+
+    // the task must not throw
+    void submit(std::function<void()> task);
+
+    // Calls function(index) for every index in [0, count) and returns when all calls are done. The calling
+    // thread works on the indices as well, so this can also be used from within a task of the same pool.
+    // The function must not throw.
+    template<typename Function>
+    void for_each_index(const usize count, Function function) {
+        struct State final {
+            std::atomic<usize> next_index{ 0 };
+            std::atomic<usize> num_finished{ 0 };
+        };
+
+        // the helper tasks may outlive this call, they only ever touch the function while indices are left
+        const auto state = std::make_shared<State>();
+        const auto run = [state, count, &function]() {
+            for (auto index = state->next_index++; index < count; index = state->next_index++) {
+                function(index);
+                if (++state->num_finished == count) {
+                    state->num_finished.notify_all();
+                }
+            }
+        };
+
+        const auto num_helpers = std::min(num_threads(), count > 0 ? count - 1 : 0);
+        for (usize i = 0; i < num_helpers; ++i) {
+            submit(run);
+        }
+        run();
+
+        for (auto finished = state->num_finished.load(); finished < count; finished = state->num_finished.load()) {
+            state->num_finished.wait(finished);
+        }
+    }
+};
@@ -1,12 +1,15 @@
 #pragma once
 
 #include "source_location.hpp"
+#include "string_interner.hpp"
 #include "types.hpp"
+#include <cassert>
 #include <string_view>
+#include <utility>
 #include <variant>
 #include <vector>
 
-enum class TokenType {
+enum class TokenType : u8 {
     And,
     Arrow,
     Asterisk,
@@ -72,9 +75,70 @@ enum class TokenType {
     Xor,
 };
 
-struct Token {
-    Token(const SourceLocation location, const TokenType type) : location{ location }, type{ type } { }
+// Tokens only store where their lexeme starts and how long it is. Everything else (filename, source code,
+// line and column numbers) is looked up through the file id in the SourceFiles table. Identifiers also carry
+// the symbol of their interned lexeme, so they can be compared without comparing their lexemes.
+struct Token final {
+private:
+    static constexpr auto type_bits = usize{ 8 };
+    static constexpr auto file_id_bits = SourceFiles::file_id_bits;
+    static constexpr auto length_bits = usize{ 32 } - type_bits - file_id_bits;
 
-    SourceLocation location;
-    TokenType type;
+    u32 m_offset;
+    u32 m_packed; // [ length | file id | type ]
+    Symbol m_symbol; // only meaningful for identifiers
+
+    Token(const SourceLocation location, const TokenType type, const Symbol symbol)
+        : m_offset{ static_cast<u32>(location.offset()) },
+          m_packed{ static_cast<u32>(
+                  (location.length() << (type_bits + file_id_bits))
+                  | (usize{ std::to_underlying(location.file_id()) } << type_bits) | std::to_underlying(type)
+          ) },
+          m_symbol{ symbol } {
+        assert(location.length() <= max_length);
+    }
+
+public:
+    static constexpr auto max_length = (usize{ 1 } << length_bits) - 1;
+
+    Token(const SourceLocation location, const TokenType type) : Token{ location, type, Symbol{} } {
+        assert(type != TokenType::Identifier);
+    }
+
+    // identifier with the given (interned) lexeme
+    Token(const SourceLocation location, const Symbol symbol) : Token{ location, TokenType::Identifier, symbol } {
+        assert(StringInterner::view(symbol) == location.lexeme());
+    }
+
+    [[nodiscard]] TokenType type() const {
+        return static_cast<TokenType>(m_packed & ((u32{ 1 } << type_bits) - 1));
+    }
+
+    [[nodiscard]] FileId file_id() const {
+        return FileId{ static_cast<u16>((m_packed >> type_bits) & ((u32{ 1 } << file_id_bits) - 1)) };
+    }
+
+    [[nodiscard]] usize offset() const {
+        return m_offset;
+    }
+
+    [[nodiscard]] usize length() const {
+        return m_packed >> (type_bits + file_id_bits);
+    }
+
+    [[nodiscard]] Symbol symbol() const {
+        assert(type() == TokenType::Identifier);
+        return m_symbol;
+    }
+
+    [[nodiscard]] SourceLocation location() const {
+        return SourceLocation{ file_id(), offset(), length() };
+    }
+
+    // the same token in another file, e.g. in an edited version of the source code
+    [[nodiscard]] Token relocated(const FileId file_id, const usize offset) const {
+        return Token{ SourceLocation{ file_id, offset, length() }, type(), m_symbol };
+    }
 };
+
+static_assert(sizeof(Token) == 12);
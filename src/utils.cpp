@@ -1,70 +1,56 @@
 #include "utils.hpp"
+#include "simd.hpp"
 #include <cassert>
-#include <gsl/gsl>
 #include <utf8proc.h>
 
 namespace utils {
 
-    [[nodiscard]] Result<std::u8string, IoError> read_text_file(const std::filesystem::path& path) {
-        // open file with file cursor at the end, binary to not have windows newlines replaced
-        auto file = std::ifstream{ path, std::ios::in | std::ios::binary | std::ios::ate };
-        if (not file) {
-            return Error<IoError>{ IoError::CouldNotOpenFile };
+    // decodes the codepoint at the start of the string, returns the number of bytes read (or nothing if invalid)
+    [[nodiscard]] static Optional<usize> next_codepoint(const std::u8string_view string, utf8proc_int32_t& codepoint) {
+        const auto bytes_read = utf8proc_iterate(
+                reinterpret_cast<const utf8proc_uint8_t*>(string.data()),
+                static_cast<utf8proc_ssize_t>(string.length()),
+                &codepoint
+        );
+        if (bytes_read <= 0 or codepoint == -1) {
+            return {};
         }
-
-        // determine filesize
-        const auto tellg_result = file.tellg();
-        if (tellg_result == decltype(tellg_result){ -1 }) {
-            return Error<IoError>{ IoError::UnableToDetermineFileSize };
-        }
-        const auto size = gsl::narrow_cast<usize>(tellg_result);
-
-        // reset file cursor to the beginning
-        file.seekg(0, std::ios::beg);
-
-        // read contents of the file
-        auto result = std::u8string{};
-        result.resize(size + 1);
-        try {
-            file.read(reinterpret_cast<char*>(result.data()), gsl::narrow_cast<std::streamsize>(size));
-        } catch (const std::ios::failure&) {
-            return Error<IoError>{ IoError::UnableToReadFile };
-        }
-
-        // always end the string with a newline
-        result.back() = '\n';
-
-        return result;
+        return static_cast<usize>(bytes_read);
     }
 
     [[nodiscard]] Result<usize, Utf8Error> utf8_width(const std::u8string_view string) {
         auto width = usize{ 0 };
-        auto current = reinterpret_cast<const utf8proc_uint8_t*>(string.data());
-        auto codepoint = utf8proc_int32_t{};
+        auto index = usize{ 0 };
+        while (true) {
+            // every ASCII character is as wide as it is long, unless it's a control character
+            const auto ascii_length = simd::ascii_prefix_length(string.substr(index));
+            width += simd::printable_ascii_count(string.substr(index, ascii_length));
+            index += ascii_length;
+            if (index >= string.length()) {
+                return width;
+            }
 
-        while (current < reinterpret_cast<const utf8proc_uint8_t*>(string.data() + string.length())) {
-            auto bytes_read = utf8proc_iterate(current, -1, &codepoint);
-            if (codepoint == -1) {
+            auto codepoint = utf8proc_int32_t{};
+            const auto bytes_read = next_codepoint(string.substr(index), codepoint);
+            if (not bytes_read) {
                 return Error<Utf8Error>{ Utf8Error::InvalidUtf8String };
             }
             assert(utf8proc_codepoint_valid(codepoint));
             width += static_cast<usize>(utf8proc_charwidth(codepoint));
-            current += bytes_read;
+            index += *bytes_read;
         }
-        if (current != reinterpret_cast<const utf8proc_uint8_t*>(string.data() + string.length())) {
-            return Error<Utf8Error>{ Utf8Error::InvalidUtf8String };
-        }
-        return width;
     }
 
     [[nodiscard]] Result<std::u8string_view, Utf8Error> first_utf8_codepoint(const std::u8string_view string) {
-        auto current = reinterpret_cast<const utf8proc_uint8_t*>(string.data());
+        if (not string.empty() and string.front() < 0x80) {
+            return string.substr(0, 1);
+        }
         auto codepoint = utf8proc_int32_t{};
-        auto bytes_read = utf8proc_iterate(current, -1, &codepoint);
-        if (codepoint == -1) {
+        const auto bytes_read = next_codepoint(string, codepoint);
+        if (not bytes_read) {
             return Error<Utf8Error>{ Utf8Error::InvalidUtf8Codepoint };
         }
-        return string.substr(0, bytes_read);
+        return string.substr(0, *bytes_read);
     }
 
     [[nodiscard]] std::string_view to_string_view(const std::u8string_view string) {
@@ -0,0 +1,6 @@
+#pragma once
+
+#include <string_view>
+
+// has to match the version in meson.build
+inline constexpr auto compiler_version = std::string_view{ "2.0.0-alpha" };